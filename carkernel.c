@@ -0,0 +1,249 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "carkernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CAR_KERNEL_X86 1
+#endif
+
+#define CAR_HASH_TICK 0x9E3779B9u
+#define CAR_HASH_CAR 0x85EBCA6Bu
+#define CAR_HASH_STREAM 0xC2B2AE35u
+
+typedef void (*CarRangeKernel)(GameState *game_state, Config *config, int begin, int end);
+
+static pthread_once_t car_kernel_once = PTHREAD_ONCE_INIT;
+static CarRangeKernel enemy_kernel;
+static CarRangeKernel friendly_kernel;
+static const char *kernel_name;
+
+// Scalar kernel for enemy cars, also used for the cars left over after the last full vector
+void update_enemy_cars_scalar(GameState *game_state, Config *config, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        update_enemy_car(game_state, config, i);
+    }
+}
+
+// Scalar kernel for friendly cars
+void update_friendly_cars_scalar(GameState *game_state, Config *config, int begin, int end) {
+    for (int i = begin; i < end; i++) {
+        update_single_friendly_car(game_state, config, i);
+    }
+}
+
+#ifdef CAR_KERNEL_X86
+
+// Eight car hashes at once, matching car_hash lane by lane
+__attribute__((target("avx2")))
+static inline __m256i car_hash_avx2(__m256i seed_and_tick, __m256i car, uint32_t stream) {
+    __m256i x = _mm256_xor_si256(seed_and_tick, _mm256_mullo_epi32(car, _mm256_set1_epi32((int)CAR_HASH_CAR)));
+    x = _mm256_xor_si256(x, _mm256_set1_epi32((int)(stream * CAR_HASH_STREAM)));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7FEB352D));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846CA68Bu));
+    return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+
+// Eight car_random_below results at once
+__attribute__((target("avx2")))
+static inline __m256i car_random_below_avx2(__m256i hash, __m256i n) {
+    return _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(hash, 16), n), 16);
+}
+
+// AVX2 kernel: update_enemy_car for eight cars per instruction
+__attribute__((target("avx2")))
+void update_enemy_cars_avx2(GameState *game_state, Config *config, int begin, int end) {
+    const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1), minus_one = _mm256_set1_epi32(-1);
+    const __m256i ten = _mm256_set1_epi32(10), last_column = _mm256_set1_epi32(config->screen_width - 1);
+    const __m256i tick = _mm256_set1_epi32(game_state->tick);
+    const __m256i seed_and_tick = _mm256_set1_epi32((int)(game_state->rng_state ^ ((uint32_t)game_state->tick * CAR_HASH_TICK)));
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    int i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(game_state->cars_x + i));
+        __m256i dir = _mm256_loadu_si256((const __m256i *)(game_state->cars_direction + i));
+        __m256i speed = _mm256_loadu_si256((const __m256i *)(game_state->car_speed + i));
+        __m256i spawn = _mm256_loadu_si256((const __m256i *)(game_state->car_spawn_tick + i));
+        __m256i wraps = _mm256_loadu_si256((const __m256i *)(game_state->car_wraps + i));
+        __m256i car = _mm256_add_epi32(_mm256_set1_epi32(i), lane);
+
+        // Hidden cars wait for their spawn tick
+        __m256i moving = _mm256_xor_si256(_mm256_cmpgt_epi32(spawn, tick), minus_one);
+
+        // Move, then bounce or wrap at the screen edges
+        x = _mm256_blendv_epi8(x, _mm256_add_epi32(x, _mm256_mullo_epi32(dir, speed)), moving);
+        __m256i over = _mm256_and_si256(moving, _mm256_cmpgt_epi32(x, last_column));
+        __m256i under = _mm256_and_si256(moving, _mm256_cmpgt_epi32(zero, x));
+        __m256i bounces = _mm256_cmpeq_epi32(wraps, zero);
+        __m256i bounce_over = _mm256_and_si256(over, bounces), bounce_under = _mm256_and_si256(under, bounces);
+        __m256i wrap_over = _mm256_andnot_si256(bounces, over), wrap_under = _mm256_andnot_si256(bounces, under);
+        __m256i delay = _mm256_add_epi32(car_random_below_avx2(car_hash_avx2(seed_and_tick, car, CAR_RANDOM_RESPAWN), ten), one);
+        dir = _mm256_blendv_epi8(dir, minus_one, bounce_over);
+        dir = _mm256_blendv_epi8(dir, one, bounce_under);
+        x = _mm256_blendv_epi8(x, last_column, _mm256_or_si256(bounce_over, wrap_under));
+        x = _mm256_blendv_epi8(x, zero, _mm256_or_si256(bounce_under, wrap_over));
+        spawn = _mm256_blendv_epi8(spawn, _mm256_add_epi32(tick, delay), _mm256_or_si256(wrap_over, wrap_under));
+
+        _mm256_storeu_si256((__m256i *)(game_state->cars_x + i), x);
+        _mm256_storeu_si256((__m256i *)(game_state->cars_direction + i), dir);
+        _mm256_storeu_si256((__m256i *)(game_state->car_spawn_tick + i), spawn);
+    }
+    update_enemy_cars_scalar(game_state, config, i, end);
+}
+
+// AVX2 kernel: update_single_friendly_car for eight cars per instruction
+__attribute__((target("avx2")))
+void update_friendly_cars_avx2(GameState *game_state, Config *config, int begin, int end) {
+    const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi32(1), minus_one = _mm256_set1_epi32(-1);
+    const __m256i last_column = _mm256_set1_epi32(config->screen_width - 1);
+    int i = begin;
+
+    for (; i + 8 <= end; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(game_state->friendly_cars_x + i));
+        __m256i dir = _mm256_loadu_si256((const __m256i *)(game_state->friendly_cars_direction + i));
+        __m256i speed = _mm256_loadu_si256((const __m256i *)(game_state->friendly_car_speed + i));
+
+        x = _mm256_add_epi32(x, _mm256_mullo_epi32(dir, speed));
+        __m256i over = _mm256_cmpgt_epi32(x, last_column), under = _mm256_cmpgt_epi32(zero, x);
+        dir = _mm256_blendv_epi8(_mm256_blendv_epi8(dir, minus_one, over), one, under);
+        x = _mm256_blendv_epi8(_mm256_blendv_epi8(x, last_column, over), zero, under);
+
+        _mm256_storeu_si256((__m256i *)(game_state->friendly_cars_x + i), x);
+        _mm256_storeu_si256((__m256i *)(game_state->friendly_cars_direction + i), dir);
+    }
+    update_friendly_cars_scalar(game_state, config, i, end);
+}
+
+// Four car hashes at once, matching car_hash lane by lane
+__attribute__((target("sse4.1")))
+static inline __m128i car_hash_sse41(__m128i seed_and_tick, __m128i car, uint32_t stream) {
+    __m128i x = _mm_xor_si128(seed_and_tick, _mm_mullo_epi32(car, _mm_set1_epi32((int)CAR_HASH_CAR)));
+    x = _mm_xor_si128(x, _mm_set1_epi32((int)(stream * CAR_HASH_STREAM)));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+    x = _mm_mullo_epi32(x, _mm_set1_epi32(0x7FEB352D));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+    x = _mm_mullo_epi32(x, _mm_set1_epi32((int)0x846CA68Bu));
+    return _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+}
+
+// Four car_random_below results at once
+__attribute__((target("sse4.1")))
+static inline __m128i car_random_below_sse41(__m128i hash, __m128i n) {
+    return _mm_srli_epi32(_mm_mullo_epi32(_mm_srli_epi32(hash, 16), n), 16);
+}
+
+// SSE4.1 kernel: update_enemy_car for four cars per instruction
+__attribute__((target("sse4.1")))
+void update_enemy_cars_sse41(GameState *game_state, Config *config, int begin, int end) {
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1), minus_one = _mm_set1_epi32(-1);
+    const __m128i ten = _mm_set1_epi32(10), last_column = _mm_set1_epi32(config->screen_width - 1);
+    const __m128i tick = _mm_set1_epi32(game_state->tick);
+    const __m128i seed_and_tick = _mm_set1_epi32((int)(game_state->rng_state ^ ((uint32_t)game_state->tick * CAR_HASH_TICK)));
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    int i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(game_state->cars_x + i));
+        __m128i dir = _mm_loadu_si128((const __m128i *)(game_state->cars_direction + i));
+        __m128i speed = _mm_loadu_si128((const __m128i *)(game_state->car_speed + i));
+        __m128i spawn = _mm_loadu_si128((const __m128i *)(game_state->car_spawn_tick + i));
+        __m128i wraps = _mm_loadu_si128((const __m128i *)(game_state->car_wraps + i));
+        __m128i car = _mm_add_epi32(_mm_set1_epi32(i), lane);
+
+        // Hidden cars wait for their spawn tick
+        __m128i moving = _mm_xor_si128(_mm_cmpgt_epi32(spawn, tick), minus_one);
+
+        // Move, then bounce or wrap at the screen edges
+        x = _mm_blendv_epi8(x, _mm_add_epi32(x, _mm_mullo_epi32(dir, speed)), moving);
+        __m128i over = _mm_and_si128(moving, _mm_cmpgt_epi32(x, last_column));
+        __m128i under = _mm_and_si128(moving, _mm_cmpgt_epi32(zero, x));
+        __m128i bounces = _mm_cmpeq_epi32(wraps, zero);
+        __m128i bounce_over = _mm_and_si128(over, bounces), bounce_under = _mm_and_si128(under, bounces);
+        __m128i wrap_over = _mm_andnot_si128(bounces, over), wrap_under = _mm_andnot_si128(bounces, under);
+        __m128i delay = _mm_add_epi32(car_random_below_sse41(car_hash_sse41(seed_and_tick, car, CAR_RANDOM_RESPAWN), ten), one);
+        dir = _mm_blendv_epi8(dir, minus_one, bounce_over);
+        dir = _mm_blendv_epi8(dir, one, bounce_under);
+        x = _mm_blendv_epi8(x, last_column, _mm_or_si128(bounce_over, wrap_under));
+        x = _mm_blendv_epi8(x, zero, _mm_or_si128(bounce_under, wrap_over));
+        spawn = _mm_blendv_epi8(spawn, _mm_add_epi32(tick, delay), _mm_or_si128(wrap_over, wrap_under));
+
+        _mm_storeu_si128((__m128i *)(game_state->cars_x + i), x);
+        _mm_storeu_si128((__m128i *)(game_state->cars_direction + i), dir);
+        _mm_storeu_si128((__m128i *)(game_state->car_spawn_tick + i), spawn);
+    }
+    update_enemy_cars_scalar(game_state, config, i, end);
+}
+
+// SSE4.1 kernel: update_single_friendly_car for four cars per instruction
+__attribute__((target("sse4.1")))
+void update_friendly_cars_sse41(GameState *game_state, Config *config, int begin, int end) {
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi32(1), minus_one = _mm_set1_epi32(-1);
+    const __m128i last_column = _mm_set1_epi32(config->screen_width - 1);
+    int i = begin;
+
+    for (; i + 4 <= end; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(game_state->friendly_cars_x + i));
+        __m128i dir = _mm_loadu_si128((const __m128i *)(game_state->friendly_cars_direction + i));
+        __m128i speed = _mm_loadu_si128((const __m128i *)(game_state->friendly_car_speed + i));
+
+        x = _mm_add_epi32(x, _mm_mullo_epi32(dir, speed));
+        __m128i over = _mm_cmpgt_epi32(x, last_column), under = _mm_cmpgt_epi32(zero, x);
+        dir = _mm_blendv_epi8(_mm_blendv_epi8(dir, minus_one, over), one, under);
+        x = _mm_blendv_epi8(_mm_blendv_epi8(x, last_column, over), zero, under);
+
+        _mm_storeu_si128((__m128i *)(game_state->friendly_cars_x + i), x);
+        _mm_storeu_si128((__m128i *)(game_state->friendly_cars_direction + i), dir);
+    }
+    update_friendly_cars_scalar(game_state, config, i, end);
+}
+
+#endif
+
+// Function to pick the widest kernels the CPU supports.
+// FROG_CAR_KERNEL=scalar|sse4.1|avx2 caps the choice, e.g. to compare kernels.
+void car_kernel_select(void) {
+    const char *limit = getenv("FROG_CAR_KERNEL");
+    int allow_sse41 = (limit == NULL || strcmp(limit, "sse4.1") == 0 || strcmp(limit, "avx2") == 0);
+    int allow_avx2 = (limit == NULL || strcmp(limit, "avx2") == 0);
+
+    enemy_kernel = update_enemy_cars_scalar;
+    friendly_kernel = update_friendly_cars_scalar;
+    kernel_name = "scalar";
+#ifdef CAR_KERNEL_X86
+    __builtin_cpu_init();
+    if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+        enemy_kernel = update_enemy_cars_avx2;
+        friendly_kernel = update_friendly_cars_avx2;
+        kernel_name = "avx2";
+    } else if (allow_sse41 && __builtin_cpu_supports("sse4.1")) {
+        enemy_kernel = update_enemy_cars_sse41;
+        friendly_kernel = update_friendly_cars_sse41;
+        kernel_name = "sse4.1";
+    }
+#else
+    (void)allow_sse41;
+    (void)allow_avx2;
+#endif
+}
+
+// Function to update enemy cars begin..end-1 with the selected kernel
+void update_enemy_car_range(GameState *game_state, Config *config, int begin, int end) {
+    pthread_once(&car_kernel_once, car_kernel_select);
+    enemy_kernel(game_state, config, begin, end);
+}
+
+// Function to move friendly cars begin..end-1 with the selected kernel
+void update_friendly_car_positions(GameState *game_state, Config *config, int begin, int end) {
+    pthread_once(&car_kernel_once, car_kernel_select);
+    friendly_kernel(game_state, config, begin, end);
+}
+
+// Function to get the name of the selected kernel
+const char* car_kernel_name(void) {
+    pthread_once(&car_kernel_once, car_kernel_select);
+    return kernel_name;
+}
@@ -0,0 +1,42 @@
+#ifndef CARKERNEL_H
+#define CARKERNEL_H
+
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+
+// Independent random streams used by each car
+enum CarRandomStream {
+    CAR_RANDOM_SPEED_GAP = 1, // Ticks until the next speed change
+    CAR_RANDOM_SPEED,         // The new speed
+    CAR_RANDOM_RESPAWN        // Spawn delay after wrapping around
+};
+
+// Counter-based random number for one car, stream and tick. Unlike game_rand it does not
+// depend on the order cars are processed in, so many cars can draw numbers at once.
+static inline uint32_t car_hash(uint32_t seed, uint32_t tick, uint32_t car, uint32_t stream) {
+    uint32_t x = seed ^ (tick * 0x9E3779B9u) ^ (car * 0x85EBCA6Bu) ^ (stream * 0xC2B2AE35u);
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Scale a car random number to 0..n-1 with a multiply instead of a division
+static inline int car_random_below(uint32_t hash, int n) {
+    return (int)(((hash >> 16) * (uint32_t)n) >> 16);
+}
+
+// Draw a random number in 0..n-1 for car i on the current tick
+static inline int car_random(GameState *game_state, int i, int stream, int n) {
+    return car_random_below(car_hash(game_state->rng_state, (uint32_t)game_state->tick, (uint32_t)i, (uint32_t)stream), n);
+}
+
+// Function declarations
+void update_enemy_car_range(GameState *game_state, Config *config, int begin, int end);
+void update_friendly_car_positions(GameState *game_state, Config *config, int begin, int end);
+const char* car_kernel_name(void);
+
+#endif
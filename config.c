@@ -18,6 +18,7 @@ void map_general_config(Config *config, const char *key, const char *value) {
     else if (strcmp(key, "stork_shape") == 0) config->stork_shape = value[0];
     else if (strcmp(key, "screen_width") == 0) config->screen_width = atoi(value);
     else if (strcmp(key, "screen_height") == 0) config->screen_height = atoi(value);
+    else if (strcmp(key, "level_pack") == 0) snprintf(config->level_pack_file, sizeof(config->level_pack_file), "%s", value);
 }
 
 // Map maximum values to the Config structure
@@ -26,8 +27,11 @@ void map_maximums_config(Config *config, const char *key, const char *value) {
     else if (strcmp(key, "max_friendly_cars") == 0) config->max_friendly_cars = atoi(value);
     else if (strcmp(key, "max_coins") == 0) config->max_coins = atoi(value);
     else if (strcmp(key, "max_obstacles") == 0) config->max_obstacles = atoi(value);
+    else if (strcmp(key, "max_storks") == 0) config->max_storks = atoi(value);
     else if (strcmp(key, "quit_time") == 0) config->quit_time = atoi(value);
     else if (strcmp(key, "proximity_threshold") == 0) config->proximity_threshold = atoi(value);
+    else if (strcmp(key, "coin_lifetime") == 0) config->coin_lifetime = atoi(value);
+    else if (strcmp(key, "lane_threads") == 0) config->lane_threads = atoi(value);
 }
 
 // Map speed values to the Config structure
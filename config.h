@@ -1,12 +1,21 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdio.h>
 #include <stdlib.h> 
 
-#define MAX_CARS 9
+#ifndef MAX_CARS
+#define MAX_CARS 9 // Build with -DMAX_CARS=... for very large boards
+#endif
+#ifndef MAX_FRIENDLY_CARS
 #define MAX_FRIENDLY_CARS 2
+#endif
 #define MAX_COINS 5
 #define MAX_OBSTACLES 20
+#define MAX_STORKS 32
+#define CONFIG_PATH_SIZE 50
+
+struct LevelPack;
 
 // Config structure stores all game configuration settings.
 typedef struct Config {
@@ -22,8 +31,11 @@ typedef struct Config {
     int max_friendly_cars;
     int max_coins;
     int max_obstacles;
+    int max_storks;
     int quit_time;
     int proximity_threshold;
+    int coin_lifetime; // Ticks before an uncollected coin expires, 0 to keep coins for the whole level
+    int lane_threads;  // Threads sharing car updates on large boards, 0 for one per CPU, 1 for none
     int max_speed_level_1;
     int max_speed_level_2;
     int max_speed_level_3;
@@ -36,9 +48,13 @@ typedef struct Config {
     short road_color;
     short obstacles_color;
     short lane_color;
+    char level_pack_file[CONFIG_PATH_SIZE]; // Compiled level pack, empty for the built-in levels
+    struct LevelPack *level_pack;           // Level pack mapped from level_pack_file, or NULL
 } Config;
 
 // Function declaration for loading configuration from file.
 void load_config(const char *filename, Config *config); // Loads game configuration settings from a file
+void read_line(FILE *file, char *line, size_t size);    // Reads one line, leaving it empty at end of file
+void parse_line(char *line, char *key, char *value);    // Splits a key=value line
 
 #endif
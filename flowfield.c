@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include "flowfield.h"
+
+#define FLOW_BLOCKED -2
+
+// Offsets of the eight neighbouring cells, matching the stork's diagonal flight
+static const int flow_dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const int flow_dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+// Function to mix one value into an FNV-1a hash
+unsigned long long flow_hash_mix(unsigned long long hash, int value) {
+    hash ^= (unsigned int)value;
+    return hash * 1099511628211ull;
+}
+
+// Function to hash the board size and obstacle layout the field depends on
+unsigned long long flow_layout_hash(GameState *game_state, Config *config) {
+    unsigned long long hash = 14695981039346656037ull;
+    hash = flow_hash_mix(hash, config->screen_width);
+    hash = flow_hash_mix(hash, config->screen_height);
+    hash = flow_hash_mix(hash, game_state->num_obstacles);
+    for (int i = 0; i < game_state->num_obstacles; i++) {
+        hash = flow_hash_mix(hash, game_state->obstacles_x[i]);
+        hash = flow_hash_mix(hash, game_state->obstacles_y[i]);
+    }
+    return hash;
+}
+
+// Function to resize the field buffers to the board size
+int flow_field_resize(FlowField *field, int width, int height) {
+    if (field->distance != NULL && field->width == width && field->height == height) {
+        return 0;
+    }
+    flow_field_free(field);
+    size_t cells = (size_t)width * (size_t)height;
+    field->distance = malloc(cells * sizeof(int));
+    field->queue = malloc(cells * sizeof(int));
+    if (field->distance == NULL || field->queue == NULL) {
+        flow_field_free(field);
+        return -1;
+    }
+    field->width = width;
+    field->height = height;
+    return 0;
+}
+
+// Function to mark the cells covered by obstacles as blocked
+void flow_field_block_obstacles(FlowField *field, GameState *game_state) {
+    for (int i = 0; i < game_state->num_obstacles; i++) {
+        int y = game_state->obstacles_y[i];
+        for (int j = 0; j < 3; j++) {
+            int x = game_state->obstacles_x[i] + j;
+            if (x >= 0 && x < field->width && y >= 0 && y < field->height) {
+                field->distance[y * field->width + x] = FLOW_BLOCKED;
+            }
+        }
+    }
+}
+
+// Function to fill the field with breadth-first distances from the frog
+void flow_field_compute(FlowField *field, GameState *game_state) {
+    int cells = field->width * field->height;
+    for (int i = 0; i < cells; i++) {
+        field->distance[i] = -1;
+    }
+    flow_field_block_obstacles(field, game_state);
+
+    int fx = game_state->frog_x, fy = game_state->frog_y;
+    if (fx < 0 || fx >= field->width || fy < 0 || fy >= field->height) {
+        return; // Frog is off the board, nothing is reachable
+    }
+
+    int head = 0, tail = 0;
+    field->distance[fy * field->width + fx] = 0;
+    field->queue[tail++] = fy * field->width + fx;
+    while (head < tail) {
+        int cell = field->queue[head++];
+        int x = cell % field->width, y = cell / field->width;
+        for (int k = 0; k < 8; k++) {
+            int nx = x + flow_dx[k], ny = y + flow_dy[k];
+            if (nx < 0 || nx >= field->width || ny < 0 || ny >= field->height) {
+                continue;
+            }
+            int next = ny * field->width + nx;
+            if (field->distance[next] == -1) {
+                field->distance[next] = field->distance[cell] + 1;
+                field->queue[tail++] = next;
+            }
+        }
+    }
+    for (int i = 0; i < cells; i++) {
+        if (field->distance[i] == FLOW_BLOCKED) {
+            field->distance[i] = -1;
+        }
+    }
+}
+
+// Function to recompute the field, but only if the frog or the obstacle layout changed.
+// A frog step shifts the distance of about half the cells by one, so repairing only the
+// changed cells would save little over a fresh BFS; the whole field is recomputed instead.
+void flow_field_update(FlowField *field, GameState *game_state, Config *config) {
+    unsigned long long layout_hash = flow_layout_hash(game_state, config);
+    if (field->valid && field->frog_x == game_state->frog_x && field->frog_y == game_state->frog_y &&
+        field->layout_hash == layout_hash) {
+        return; // Nothing changed since the last computation
+    }
+    if (flow_field_resize(field, config->screen_width, config->screen_height) < 0) {
+        field->valid = 0;
+        return;
+    }
+    flow_field_compute(field, game_state);
+    field->frog_x = game_state->frog_x;
+    field->frog_y = game_state->frog_y;
+    field->layout_hash = layout_hash;
+    field->valid = 1;
+}
+
+// Function to check whether a neighbouring cell is one step closer to the frog
+int flow_field_is_downhill(FlowField *field, int x, int y, int dx, int dy, int here) {
+    int nx = x + dx, ny = y + dy;
+    if (nx < 0 || nx >= field->width || ny < 0 || ny >= field->height) {
+        return 0;
+    }
+    return field->distance[ny * field->width + nx] == here - 1;
+}
+
+// Function to look up the next step toward the frog, returning 0 when there is none
+int flow_field_step(FlowField *field, int x, int y, int *dx, int *dy) {
+    if (!field->valid || x < 0 || x >= field->width || y < 0 || y >= field->height) {
+        return 0;
+    }
+    int here = field->distance[y * field->width + x];
+    if (here <= 0) {
+        return 0; // Already on the frog or cut off from it
+    }
+
+    // Prefer the straight-line direction, then any other neighbour on a shortest path
+    int gx = (field->frog_x > x) ? 1 : ((field->frog_x < x) ? -1 : 0);
+    int gy = (field->frog_y > y) ? 1 : ((field->frog_y < y) ? -1 : 0);
+    if (flow_field_is_downhill(field, x, y, gx, gy, here)) {
+        *dx = gx;
+        *dy = gy;
+        return 1;
+    }
+    for (int k = 0; k < 8; k++) {
+        if (flow_field_is_downhill(field, x, y, flow_dx[k], flow_dy[k], here)) {
+            *dx = flow_dx[k];
+            *dy = flow_dy[k];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to release the field buffers
+void flow_field_free(FlowField *field) {
+    free(field->distance);
+    free(field->queue);
+    field->distance = NULL;
+    field->queue = NULL;
+    field->width = 0;
+    field->height = 0;
+    field->valid = 0;
+}
@@ -0,0 +1,23 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include "config.h"
+#include "game.h"
+
+// FlowField stores the walking distance from every cell of the board to the frog,
+// so any number of pursuers can look up their next step in constant time
+typedef struct FlowField {
+    int width, height;
+    int *distance; // Steps to the frog for each cell, -1 if unreachable or blocked
+    int *queue;    // BFS work queue, one entry per cell
+    int frog_x, frog_y;
+    unsigned long long layout_hash; // Obstacle layout the field was computed for
+    int valid;
+} FlowField;
+
+// Function declarations
+void flow_field_update(FlowField *field, GameState *game_state, Config *config);
+int flow_field_step(FlowField *field, int x, int y, int *dx, int *dy);
+void flow_field_free(FlowField *field);
+
+#endif
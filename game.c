@@ -1,15 +1,47 @@
 #include "game.h"
+#include "carkernel.h"
+#include "flowfield.h"
+#include "lanepool.h"
+#include "levelpack.h"
+#include "packed_state.h"
+#include "pregen.h"
+#include "trace.h"
 #include <string.h>
 #define COLOR_GREY 8
+
+// Distance field shared by all storks, recomputed only when the frog moves
+static FlowField stork_field;
+
+// Next level, generated in the background while the current one is played
+static LevelPregen next_level_pregen;
+
+// Threads sharing the car updates of large boards
+static LanePool lane_pool;
+
+// Function to draw the next number from the generator stored in the game state,
+// so the simulation can be replayed exactly from a snapshot
+int game_rand(GameState *game_state) {
+    game_state->rng_state = game_state->rng_state * 1103515245u + 12345u;
+    return (int)((game_state->rng_state >> 16) & 0x7fff);
+}
+
 // Function to save the game state to a file
 void save_game(GameState *game_state, const char *filename) {
+    TRACE_BEGIN(__func__);
     FILE *file = fopen(filename, "wb"); // Open the file in binary write mode
     if (file == NULL) {
         perror("Error opening file for saving");
+        TRACE_END(__func__);
         return;
     }
-    fwrite(game_state, sizeof(GameState), 1, file); // Write the game state to the file
+    SaveHeader header;
+    save_header_init(&header);
+    static PackedState packed; // Static, since a -DMAX_CARS build can make it too big for a thread stack
+    pack_state(game_state, &packed);
+    fwrite(&header, sizeof(SaveHeader), 1, file); // Write the format header first
+    fwrite(&packed, sizeof(PackedState), 1, file); // Write the compact game state to the file
     fclose(file); // Close the file
+    TRACE_END(__func__);
 }
 
 // Function to load the game state from a file
@@ -19,7 +51,16 @@ void load_game(GameState *game_state, const char *filename) {
         perror("Error opening file for loading");
         return;
     }
-    fread(game_state, sizeof(GameState), 1, file); // Read the game state from the file
+    SaveHeader header;
+    if (fread(&header, sizeof(SaveHeader), 1, file) != 1 || !save_header_valid(&header)) {
+        fprintf(stderr, "%s is not a save file from this version of the game.\n", filename);
+        fclose(file);
+        return;
+    }
+    static PackedState packed;
+    if (fread(&packed, sizeof(PackedState), 1, file) == 1) { // Read the compact game state from the file
+        unpack_state(&packed, game_state);
+    }
     fclose(file); // Close the file
 }
 
@@ -103,13 +144,16 @@ void Welcome(WINDOW *win) {
 
 // Function to draw the frog character
 void draw_frog(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->frog_color));
     mvaddch(game_state->frog_y, game_state->frog_x, (unsigned int)config->frog_shape); // Draw frog at its current position
     attroff(COLOR_PAIR(config->frog_color));
+    TRACE_END(__func__);
 }
 
 // Function to draw the road stripes
 void draw_road_stripes(int screen_height, int screen_width) {
+    TRACE_BEGIN(__func__);
     for (int y = 2; y < screen_height - 2; y++) {
         if (y % 2 == 0) {
             for (int x = 0; x < screen_width; x++) {
@@ -117,10 +161,12 @@ void draw_road_stripes(int screen_height, int screen_width) {
             }
         }
     }
+    TRACE_END(__func__);
 }
 
 // Function to draw the road background
 void draw_road(int screen_height, int screen_width, Config *config) {
+    TRACE_BEGIN(__func__);
     for (int y = 2; y < screen_height - 2; y++) {
         for (int x = 0; x < screen_width; x++) {
             attron(COLOR_PAIR(config->road_color));
@@ -129,51 +175,66 @@ void draw_road(int screen_height, int screen_width, Config *config) {
         }
     }
     draw_road_stripes(screen_height, screen_width); // Draw road stripes
+    TRACE_END(__func__);
 }
 
 
 // Function to draw the goal area
 void draw_goal(int screen_width, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->goal_color));
     for (int x = 0; x < screen_width; x++) {
         mvaddch(1, x, 'G'); // Draw goal area
     }
     attroff(COLOR_PAIR(config->goal_color));
+    TRACE_END(__func__);
 }
 
 // Function to draw cars on the road
 void draw_cars(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->car_color));
-    for (int i = 0; i < MAX_CARS; i++) {
-        if (game_state->car_spawn_delay[i] == 0) { // Check if car should be visible
+    for (int i = 0; i < game_state->num_cars; i++) {
+        if (game_state->tick >= game_state->car_spawn_tick[i]) { // Check if car should be visible
             mvaddch(game_state->cars_y[i], game_state->cars_x[i], (unsigned int)config->car_shape); // Draw car
         }
     }
     attroff(COLOR_PAIR(config->car_color));
+    TRACE_END(__func__);
 }
 
 // Function to draw friendly cars that help the frog
 void draw_friendly_cars(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->friendly_car_color));
-    for (int i = 0; i < MAX_FRIENDLY_CARS; i++) {
+    for (int i = 0; i < game_state->num_friendly_cars; i++) {
         mvaddch(game_state->friendly_cars_y[i], game_state->friendly_cars_x[i], (unsigned int)config->friendly_car_shape); // Draw friendly car
     }
     attroff(COLOR_PAIR(config->friendly_car_color));
+    TRACE_END(__func__);
+}
+
+// Function to get the number of coins per level, capped to the coin arrays and timers
+int coin_count(Config *config) {
+    return (config->max_coins < MAX_COINS) ? config->max_coins : MAX_COINS;
 }
 
 // Function to draw coins that the frog can collect
 void draw_coins(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->coin_color));
-    for (int i = 0; i < MAX_COINS; i++) {
+    for (int i = 0; i < coin_count(config); i++) {
         if (!game_state->coins_collected[i]) {
             mvaddch(game_state->coins_y[i], game_state->coins_x[i], 'O'); // Draw coin
         }
     }
     attroff(COLOR_PAIR(config->coin_color));
+    TRACE_END(__func__);
 }
 
 // Function to draw obstacles on the road
 void draw_obstacles(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->obstacles_color));
     for (int i = 0; i < MAX_OBSTACLES; i++) {
         for (int j = 0; j < 3; j++) {
@@ -181,13 +242,18 @@ void draw_obstacles(GameState *game_state, Config *config) {
         }
     }
     attroff(COLOR_PAIR(config->obstacles_color));
+    TRACE_END(__func__);
 }
 
-// Function to draw the stork character
+// Function to draw the stork characters
 void draw_stork(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
     attron(COLOR_PAIR(config->stork_color));
-    mvaddch(game_state->stork_y, game_state->stork_x, (unsigned int)config->stork_shape); // Draw stork
+    for (int i = 0; i < game_state->num_storks; i++) {
+        mvaddch(game_state->stork_y[i], game_state->stork_x[i], (unsigned int)config->stork_shape); // Draw stork
+    }
     attroff(COLOR_PAIR(config->stork_color));
+    TRACE_END(__func__);
 }
 
 // Function to get time since the last frog jump
@@ -204,20 +270,23 @@ void move_frog_position(GameState *game_state, Config *config, int dx, int dy) {
         // Check for barriers
         game_state->frog_x += dx;
         game_state->frog_y += dy;
-        if (check_collision(game_state, config) == 2) {
+        if (check_collision(game_state) == 2) {
             game_state->frog_x -= dx; // Revert if a barrier is encountered
             game_state->frog_y -= dy; // Revert if a barrier is encountered
         }
     }
 }
 
-// Function to move the stork closer to the frog
-void move_stork(GameState *game_state) {
-    int stork_dx = (game_state->frog_x > game_state->stork_x) ? 1 : ((game_state->frog_x < game_state->stork_x) ? -1 : 0);
-    int stork_dy = (game_state->frog_y > game_state->stork_y) ? 1 : ((game_state->frog_y < game_state->stork_y) ? -1 : 0);
-
-    game_state->stork_x += stork_dx; // Move stork horizontally
-    game_state->stork_y += stork_dy; // Move stork vertically
+// Function to move every stork one step along the shortest path around obstacles to the frog
+void move_storks(GameState *game_state, Config *config) {
+    flow_field_update(&stork_field, game_state, config);
+    for (int i = 0; i < game_state->num_storks; i++) {
+        int stork_dx, stork_dy;
+        if (flow_field_step(&stork_field, game_state->stork_x[i], game_state->stork_y[i], &stork_dx, &stork_dy)) {
+            game_state->stork_x[i] += stork_dx; // Move stork horizontally
+            game_state->stork_y[i] += stork_dy; // Move stork vertically
+        }
+    }
 }
 
 // Function to update the frog's carrying status
@@ -226,29 +295,26 @@ void update_frog_carrying_status(GameState *game_state) {
     game_state->carrying_car_index = -1; // Reset carrying car index
 }
 
-// Function to update the last jump time and step count
-void update_jump_time_and_steps(GameState *game_state) {
-    game_state->last_jump_time = time(NULL); // Update the last jump time
+// Function to make the frog jump, handling carrying status and stork movements
+void jump_frog(GameState *game_state, Config *config, int dx, int dy) {
+    if (game_state->frog_carried) { // If frog is being carried, update status
+        update_frog_carrying_status(game_state);
+    } else {
+        move_frog_position(game_state, config, dx, dy); // Move frog
+    }
     game_state->frog_steps++; // Increment frog's step count
+
+    // Move storks every stork_interval frog steps
+    if (game_state->num_storks > 0 && game_state->stork_interval > 0 && game_state->frog_steps % game_state->stork_interval == 0) {
+        move_storks(game_state, config);
+    }
 }
 
-// Function to move the frog and handle carrying status and stork movements
+// Function to move the frog at most once per second
 void move_frog(GameState *game_state, Config *config, int dx, int dy) {
     if (get_time_since_last_jump(game_state->last_jump_time) >= 1.0) {
-        if (game_state->frog_carried) { // If frog is being carried, update status
-            update_frog_carrying_status(game_state);
-        } else {
-            move_frog_position(game_state, config, dx, dy); // Move frog
-        }
-        update_jump_time_and_steps(game_state);
-
-        // Move stork if conditions are met
-        if (game_state->level >= 2) {
-            if ((game_state->level == 2 && game_state->frog_steps % 2 == 0) ||
-                (game_state->level >= 3 && game_state->frog_steps % 1 == 0)) {
-                move_stork(game_state);
-            }
-        }
+        jump_frog(game_state, config, dx, dy);
+        game_state->last_jump_time = time(NULL); // Update the last jump time
     }
 }
 
@@ -274,8 +340,8 @@ void check_frog_carried(GameState *game_state, int i) {
 
 // Function to update the positions of friendly cars
 void update_friendly_cars(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_friendly_cars; i++) {
-        update_single_friendly_car(game_state, config, i); // Update position and direction of friendly car
+    lane_pool_run(&lane_pool, update_friendly_car_positions, game_state, config, game_state->num_friendly_cars); // Batched, split by lane on large boards
+    for (int i = 0; i < game_state->num_friendly_cars; i++) {
         check_frog_carried(game_state, i); // Check if frog is on the friendly car
     }
 }
@@ -295,7 +361,7 @@ void move_car(GameState *game_state, int i) {
 
 // Function to update car direction and position based on screen boundaries
 void update_car_direction(GameState *game_state, Config *config, int i) {
-    if (i < 5) { // Logic for first 5 cars
+    if (!game_state->car_wraps[i]) { // Cars that bounce off the screen edges
         if (game_state->cars_x[i] >= config->screen_width) {
             game_state->cars_direction[i] = -1; // Change direction to left
             game_state->cars_x[i] = (short int)(config->screen_width - 1);
@@ -303,55 +369,138 @@ void update_car_direction(GameState *game_state, Config *config, int i) {
             game_state->cars_direction[i] = 1; // Change direction to right
             game_state->cars_x[i] = 0;
         }
-    } else { // Logic for other cars
+    } else { // Cars that wrap around and respawn
         if (game_state->cars_x[i] >= config->screen_width) {
             game_state->cars_x[i] = 0;
-            game_state->car_spawn_delay[i] = rand() % 10 + 1; // Random spawn delay
+            game_state->car_spawn_tick[i] = game_state->tick + car_random(game_state, i, CAR_RANDOM_RESPAWN, 10) + 1; // Random spawn delay
         } else if (game_state->cars_x[i] < 0) {
             game_state->cars_x[i] = (short int)(config->screen_width - 1);
-            game_state->car_spawn_delay[i] = rand() % 10 + 1; // Random spawn delay
+            game_state->car_spawn_tick[i] = game_state->tick + car_random(game_state, i, CAR_RANDOM_RESPAWN, 10) + 1; // Random spawn delay
         }
     }
 }
 
-// Function to handle car spawn delays
-void handle_car_spawn_delay(GameState *game_state, int i) {
-    if (game_state->car_spawn_delay[i] > 0) {
-        game_state->car_spawn_delay[i]--;
+// Function to move one enemy car and turn or wrap it at the screen edges.
+// This is the reference for the batched kernels in carkernel.c, which must match it exactly.
+void update_enemy_car(GameState *game_state, Config *config, int i) {
+    if (game_state->tick >= game_state->car_spawn_tick[i]) { // Hidden cars wait for their spawn tick
+        move_car(game_state, i); // Move the car
+        update_car_direction(game_state, config, i); // Update its direction
     }
 }
 
-// Function to update enemy cars, including their movement and direction
-void update_enemy_cars(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_cars; i++) {
-        handle_car_spawn_delay(game_state, i);
-
-        if (game_state->car_spawn_delay[i] == 0) {
-            // Logic for stopping cars if frog is near
-            if (game_state->stopping_cars[i] && abs(game_state->frog_x - game_state->cars_x[i]) + abs(game_state->frog_y - game_state->cars_y[i]) <= config->proximity_threshold) {
-                game_state->car_speed[i] = 0;
-            } else {
-                // Adjust car speed at random intervals
-                if (i % 2 == 0 && rand() % 10 < 1) {
-                    game_state->car_speed[i] = (short int)((rand() % config->max_speed_level_3) + 1);
-                }
-                move_car(game_state, i); // Move the car
-                update_car_direction(game_state, config, i); // Update its direction
-            }
+// Function to stop a stopping car if the frog is near, and schedule its next check for the
+// first tick the answer could change while the frog stays where it is
+void check_stopping_car(GameState *game_state, Config *config, int i) {
+    timer_wheel_cancel(&game_state->timers, CAR_STOP_TIMER(i));
+    if (game_state->tick < game_state->car_spawn_tick[i]) {
+        timer_wheel_schedule(&game_state->timers, CAR_STOP_TIMER(i), game_state->car_spawn_tick[i]); // Look again when it reappears
+        return;
+    }
+
+    int distance = abs(game_state->frog_x - game_state->cars_x[i]) + abs(game_state->frog_y - game_state->cars_y[i]);
+    int speed = game_state->car_speed[i];
+    if (distance <= config->proximity_threshold) {
+        game_state->car_speed[i] = 0; // Stays stopped until the frog moves
+        return;
+    }
+    if (speed <= 0) {
+        return; // Standing still, so only the frog moving can bring it in range
+    }
+
+    int wait = (distance - config->proximity_threshold + speed - 1) / speed; // Closes in by at most speed per tick
+    if (game_state->car_wraps[i]) {
+        int x = game_state->cars_x[i];
+        int to_edge = (game_state->cars_direction[i] > 0) ? (config->screen_width - x + speed - 1) / speed : x / speed + 1;
+        wait = (to_edge < wait) ? to_edge : wait; // Wrapping jumps it to the other side
+    }
+    timer_wheel_schedule(&game_state->timers, CAR_STOP_TIMER(i), game_state->tick + wait);
+}
+
+// Function to give a car a random new speed and schedule its next speed change
+void change_car_speed(GameState *game_state, Config *config, int i) {
+    game_state->car_speed[i] = car_random(game_state, i, CAR_RANDOM_SPEED, game_state->car_max_speed[i]) + 1;
+    timer_wheel_schedule(&game_state->timers, CAR_SPEED_TIMER(i), game_state->tick + car_random(game_state, i, CAR_RANDOM_SPEED_GAP, 19) + 1);
+    if (game_state->stopping_cars[i]) {
+        check_stopping_car(game_state, config, i); // Stays stopped if the frog is near, and the new speed moves its next check
+    }
+}
+
+// Function to run a timer that has come due
+void run_timer(GameState *game_state, Config *config, int timer) {
+    if (timer < CAR_STOP_TIMER(0)) {
+        change_car_speed(game_state, config, timer - CAR_SPEED_TIMER(0));
+    } else if (timer < COIN_TIMER(0)) {
+        check_stopping_car(game_state, config, timer - CAR_STOP_TIMER(0));
+    } else {
+        game_state->coins_collected[timer - COIN_TIMER(0)] = 1; // Expired coins disappear like collected ones
+    }
+}
+
+// Function to schedule the events of a freshly set up level
+void schedule_level_events(GameState *game_state, Config *config) {
+    timer_wheel_init(&game_state->timers, game_state->tick);
+    game_state->watched_frog_x = game_state->frog_x;
+    game_state->watched_frog_y = game_state->frog_y;
+    game_state->num_stopping = 0;
+    for (int i = 0; i < game_state->num_cars; i++) {
+        if (game_state->car_max_speed[i] > 0) {
+            timer_wheel_schedule(&game_state->timers, CAR_SPEED_TIMER(i), game_state->tick + car_random(game_state, i, CAR_RANDOM_SPEED_GAP, 19) + 1);
+        }
+        if (game_state->stopping_cars[i]) {
+            game_state->stopping_list[game_state->num_stopping++] = i;
+            check_stopping_car(game_state, config, i);
+        }
+    }
+    for (int i = 0; i < coin_count(config) && config->coin_lifetime > 0; i++) {
+        timer_wheel_schedule(&game_state->timers, COIN_TIMER(i), game_state->tick + config->coin_lifetime);
+    }
+}
+
+// Function to run the car and coin events due by the current tick. Only cars with
+// something due are visited, except that the stopping cars look again when the frog moves.
+void run_car_events(GameState *game_state, Config *config) {
+    if (game_state->frog_x != game_state->watched_frog_x || game_state->frog_y != game_state->watched_frog_y) {
+        game_state->watched_frog_x = game_state->frog_x;
+        game_state->watched_frog_y = game_state->frog_y;
+        for (int i = 0; i < game_state->num_stopping; i++) {
+            check_stopping_car(game_state, config, game_state->stopping_list[i]);
+        }
+    }
+    while (game_state->timers.current < game_state->tick) {
+        timer_wheel_advance(&game_state->timers);
+        int timer;
+        while ((timer = timer_wheel_pop(&game_state->timers)) != TIMER_NONE) {
+            run_timer(game_state, config, timer);
         }
     }
 }
 
+// Function to update enemy cars: due events first, then movement with the widest kernel the CPU
+// supports, split by lane across the pool on large boards. Every lane is done when it returns.
+void update_enemy_cars(GameState *game_state, Config *config) {
+    run_car_events(game_state, config);
+    lane_pool_run(&lane_pool, update_enemy_car_range, game_state, config, game_state->num_cars);
+}
+
+// Function to stop the lane threads before the game exits
+void stop_lane_pool(void) {
+    lane_pool_stop(&lane_pool);
+}
+
 // Function to update the game state by updating cars and frog
 void update_game(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
+    game_state->tick++;
     update_friendly_cars(game_state, config);
     update_frog(game_state);
     update_enemy_cars(game_state, config);
+    TRACE_END(__func__);
 }
 
 // Checks for collision with cars
-int check_car_collision(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_cars; i++) {
+int check_car_collision(GameState *game_state) {
+    for (int i = 0; i < game_state->num_cars; i++) {
         int hitbox_size = game_state->car_speed[i];
         for (int j = -hitbox_size; j <= hitbox_size; j++) {
             if (game_state->frog_x == game_state->cars_x[i] + j && game_state->frog_y == game_state->cars_y[i]) {
@@ -374,10 +523,10 @@ int check_obstacle_collision(GameState *game_state) {
     return 0;
 }
 
-// Checks for collision with stork if level is 2 or higher
+// Checks for collision with storks
 int check_stork_collision(GameState *game_state) {
-    if (game_state->level >= 2) {
-        if (game_state->frog_x == game_state->stork_x && game_state->frog_y == game_state->stork_y) {
+    for (int i = 0; i < game_state->num_storks; i++) {
+        if (game_state->frog_x == game_state->stork_x[i] && game_state->frog_y == game_state->stork_y[i]) {
             return 1; // Collision detected
         }
     }
@@ -385,55 +534,48 @@ int check_stork_collision(GameState *game_state) {
 }
 
 // Main function to check for collisions with cars, obstacles, and stork
-int check_collision(GameState *game_state, Config *config) {
-    if (game_state->frog_carried) {
-        return 0; // No collision if frog is being carried
-    }
-
-    int collision_result;
-
-    collision_result = check_car_collision(game_state, config);
-    if (collision_result != 0) {
-        return collision_result;
-    }
-
-    collision_result = check_obstacle_collision(game_state);
-    if (collision_result != 0) {
-        return collision_result;
-    }
-
-    collision_result = check_stork_collision(game_state);
-    if (collision_result != 0) {
-        return collision_result;
+int check_collision(GameState *game_state) {
+    TRACE_BEGIN(__func__);
+    int collision_result = 0;
+
+    if (!game_state->frog_carried) { // No collision if frog is being carried
+        collision_result = check_car_collision(game_state);
+        if (collision_result == 0) {
+            collision_result = check_obstacle_collision(game_state);
+        }
+        if (collision_result == 0) {
+            collision_result = check_stork_collision(game_state);
+        }
     }
 
-    return 0;
+    TRACE_END(__func__);
+    return collision_result;
 }
 
 
 
 // Function to check if the frog has collected any coins
 void check_coin_collection(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_coins; i++) {
+    for (int i = 0; i < coin_count(config); i++) {
         if (game_state->frog_x == game_state->coins_x[i] && game_state->frog_y == game_state->coins_y[i] && !game_state->coins_collected[i]) {
             game_state->score++;
             game_state->coins_collected[i] = 1; // Mark coin as collected
+            timer_wheel_cancel(&game_state->timers, COIN_TIMER(i));
         }
     }
 }
 
 // Function to generate coins in random positions
 void generate_coins(GameState *game_state, Config *config) {
-    srand((unsigned int)time(NULL));
-    for (int i = 0; i < config->max_coins; i++) {
-        game_state->coins_x[i] = rand() % config->screen_width;
-        game_state->coins_y[i] = rand() % (config->screen_height - 4) + 2; // Avoid top and bottom rows
+    for (int i = 0; i < coin_count(config); i++) {
+        game_state->coins_x[i] = game_rand(game_state) % config->screen_width;
+        game_state->coins_y[i] = game_rand(game_state) % (config->screen_height - 4) + 2; // Avoid top and bottom rows
         game_state->coins_collected[i] = 0;
 
         // Ensure no two coins have the same y position
         for (int j = 0; j < i; j++) {
             while (game_state->coins_y[i] == game_state->coins_y[j]) {
-                game_state->coins_y[i] = rand() % (config->screen_height - 4) + 2;
+                game_state->coins_y[i] = game_rand(game_state) % (config->screen_height - 4) + 2;
             }
         }
     }
@@ -441,8 +583,10 @@ void generate_coins(GameState *game_state, Config *config) {
 
 // Function to generate obstacles in random positions
 void generate_obstacles(GameState *game_state, Config *config) {
-    srand((unsigned int)time(NULL));
     int num_obstacles = (config->screen_width * config->screen_height) / 200; // Number of obstacles based on screen size
+    if (num_obstacles > MAX_OBSTACLES) {
+        num_obstacles = MAX_OBSTACLES; // Large terminals must not overflow the obstacle arrays
+    }
     game_state->num_obstacles = num_obstacles;
 
     for (int i = 0; i < num_obstacles; i++) {
@@ -450,11 +594,11 @@ void generate_obstacles(GameState *game_state, Config *config) {
 
         while (!valid_position) {
             valid_position = 1;
-            game_state->obstacles_x[i] = rand() % config->screen_width;
-            game_state->obstacles_y[i] = rand() % (config->screen_height - 4) + 2;
+            game_state->obstacles_x[i] = game_rand(game_state) % config->screen_width;
+            game_state->obstacles_y[i] = game_rand(game_state) % (config->screen_height - 4) + 2;
 
             // Check if obstacle overlaps with a car
-            for (int j = 0; j < config->max_cars; j++) {
+            for (int j = 0; j < game_state->num_cars; j++) {
                 if (game_state->obstacles_y[i] == game_state->cars_y[j]) {
                     valid_position = 0;
                     break;
@@ -472,35 +616,38 @@ void initialize_frog(GameState *game_state, Config *config) {
 
 // Function to initialize the positions and properties of enemy cars
 void initialize_cars(GameState *game_state, Config *config) {
-    srand((unsigned int)time(NULL));
-    for (int i = 0; i < config->max_cars; i++) {
-        game_state->cars_x[i] = rand() % config->screen_width;
+    game_state->num_cars = (config->max_cars < MAX_CARS) ? config->max_cars : MAX_CARS;
+    for (int i = 0; i < game_state->num_cars; i++) {
+        game_state->cars_x[i] = game_rand(game_state) % config->screen_width;
         game_state->cars_y[i] = 2 + i * 2; // Position cars on different rows
-        game_state->cars_direction[i] = (short int)((rand() % 2 == 0) ? 1 : -1); // Randomize car direction
+        game_state->cars_direction[i] = (short int)((game_rand(game_state) % 2 == 0) ? 1 : -1); // Randomize car direction
         int max_speed = (game_state->level == 1) ? config->max_speed_level_1 : (game_state->level == 2) ? config->max_speed_level_2 : config->max_speed_level_3;
-        game_state->car_speed[i] = (short int)(rand() % max_speed + 1); // Randomize car speed based on level
-        game_state->car_spawn_delay[i] = rand() % 10 + 1; // Randomize spawn delay
+        game_state->car_speed[i] = (short int)(game_rand(game_state) % max_speed + 1); // Randomize car speed based on level
+        game_state->car_spawn_tick[i] = game_state->tick + game_rand(game_state) % 10 + 1; // Randomize spawn delay
+        game_state->car_wraps[i] = (i >= 5); // First 5 cars bounce, the others wrap around
+        game_state->car_max_speed[i] = (i % 2 == 0) ? config->max_speed_level_3 : 0; // Even cars change speed at random
     }
 }
 
 // Function to initialize the positions and properties of friendly cars
 void initialize_friendly_cars(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_friendly_cars; i++) {
-        game_state->friendly_cars_x[i] = rand() % config->screen_width;
+    game_state->num_friendly_cars = (config->max_friendly_cars < MAX_FRIENDLY_CARS) ? config->max_friendly_cars : MAX_FRIENDLY_CARS;
+    for (int i = 0; i < game_state->num_friendly_cars; i++) {
+        game_state->friendly_cars_x[i] = game_rand(game_state) % config->screen_width;
         game_state->friendly_cars_y[i] = 2 + (i * 2) % (config->screen_height - 4); // Avoid top and bottom rows
-        game_state->friendly_cars_direction[i] = (short int)((rand() % 2 == 0) ? 1 : -1); // Randomize direction
-        game_state->friendly_car_speed[i] = (short int)(rand() % config->max_speed_level_1 + 1); // Randomize speed
+        game_state->friendly_cars_direction[i] = (short int)((game_rand(game_state) % 2 == 0) ? 1 : -1); // Randomize direction
+        game_state->friendly_car_speed[i] = (short int)(game_rand(game_state) % config->max_speed_level_1 + 1); // Randomize speed
     }
 }
 
 // Function to initialize which cars will stop if frog is near
-void initialize_stopping_cars(GameState *game_state, Config *config) {
-    for (int i = 0; i < config->max_cars; i++) {
+void initialize_stopping_cars(GameState *game_state) {
+    for (int i = 0; i < game_state->num_cars; i++) {
         game_state->stopping_cars[i] = 0;
     }
     int stopping_car_count = 0;
-    while (stopping_car_count < 2) { // Ensure there are two stopping cars
-        int car_index = rand() % config->max_cars;
+    while (stopping_car_count < 2 && stopping_car_count < game_state->num_cars) { // Ensure there are two stopping cars
+        int car_index = game_rand(game_state) % game_state->num_cars;
         if (!game_state->stopping_cars[car_index]) {
             game_state->stopping_cars[car_index] = 1;
             stopping_car_count++;
@@ -508,31 +655,67 @@ void initialize_stopping_cars(GameState *game_state, Config *config) {
     }
 }
 
-// Function to initialize the stork's starting position
+// Function to initialize the storks' starting positions
 void initialize_stork(GameState *game_state, Config *config) {
+    game_state->num_storks = 0;
+    game_state->stork_interval = (game_state->level == 2) ? 2 : 1; // Storks move every other step on level 2
     if (game_state->level >= 2) {
-        game_state->stork_x = (short int)(config->screen_width - 1); // Position stork at the right edge
-        game_state->stork_y = (short int)(config->screen_height - 2); // Position stork at the bottom
+        int max_storks = (config->max_storks < MAX_STORKS) ? config->max_storks : MAX_STORKS;
+        game_state->num_storks = (game_state->level == 2 || max_storks < 1) ? 1 : max_storks; // One stork on level 2, the full flock later
+        int spacing = config->screen_width / (2 * game_state->num_storks);
+        for (int i = 0; i < game_state->num_storks; i++) {
+            game_state->stork_x[i] = config->screen_width - 1 - i * spacing; // Spread storks from the right edge
+            game_state->stork_y[i] = config->screen_height - 2; // Position storks at the bottom
+        }
     }
 }
 
 // Function to restart the game by reinitializing all elements
 void restart_game(GameState *game_state, Config *config) {
+    TRACE_BEGIN(__func__);
+    game_state->tick = 0; // Ticks count from the start of the level, so a pre-generated level fits any time
     initialize_frog(game_state, config);
-    initialize_cars(game_state, config);
-    initialize_friendly_cars(game_state, config);
-    initialize_stopping_cars(game_state, config);
-    initialize_stork(game_state, config);
+    if (!level_pack_apply(config->level_pack, game_state, config)) { // Built-in levels unless the level pack defines this one
+        initialize_cars(game_state, config);
+        initialize_friendly_cars(game_state, config);
+        initialize_stopping_cars(game_state);
+        initialize_stork(game_state, config);
+        generate_obstacles(game_state, config);
+    }
     generate_coins(game_state, config);
-    generate_obstacles(game_state, config);
+    schedule_level_events(game_state, config);
     game_state->frog_steps = 0; // Reset frog steps
+    TRACE_END(__func__);
+}
+
+// Function to get the number of the last level
+int last_level(Config *config) {
+    return (level_pack_count(config->level_pack) > 0) ? level_pack_count(config->level_pack) : 3;
+}
+
+// Function to set up the current level and start generating the one after it
+void start_level(GameState *game_state, Config *config) {
+    restart_game(game_state, config);
+    if (game_state->level < last_level(config)) {
+        level_pregen_start(&next_level_pregen, game_state, config);
+    }
+}
+
+// Function to wait for background level generation before the game exits
+void stop_level_pregen(void) {
+    level_pregen_stop(&next_level_pregen);
 }
 
 // Function to progress to the next level or end the game if the max level is reached
 void next_level(GameState *game_state, Config *config) {
-    if (game_state->level < 3) {
+    if (game_state->level < last_level(config)) {
         game_state->level++;
-        restart_game(game_state, config);
+        if (!level_pregen_take(&next_level_pregen, game_state, config)) {
+            restart_game(game_state, config); // The pre-generated level no longer fits, build it now
+        }
+        if (game_state->level < last_level(config)) {
+            level_pregen_start(&next_level_pregen, game_state, config);
+        }
     } else {
         game_state->lives = 0; // End the game if max level is reached
     }
@@ -5,6 +5,10 @@
 #include <time.h>
 #include <stdlib.h>
 #include "config.h"
+#include "timerwheel.h"
+
+#define CACHE_LINE_SIZE 64
+#define CACHE_LINE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
 
 // GameState structure to store the game state, including positions of the frog, cars, coins, and obstacles
 typedef struct GameState {
@@ -12,15 +16,20 @@ typedef struct GameState {
     int frog_x, frog_y;
     
     // Positions, directions, and speeds of the cars
-    int cars_x[MAX_CARS], cars_y[MAX_CARS];
-    int cars_direction[MAX_CARS];
-    int car_speed[MAX_CARS];
-    int car_spawn_delay[MAX_CARS];
+    // Each array starts on a cache line, so lane pool threads never share one
+    int num_cars;
+    int cars_x[MAX_CARS] CACHE_LINE_ALIGNED, cars_y[MAX_CARS] CACHE_LINE_ALIGNED;
+    int cars_direction[MAX_CARS] CACHE_LINE_ALIGNED;
+    int car_speed[MAX_CARS] CACHE_LINE_ALIGNED;
+    int car_spawn_tick[MAX_CARS] CACHE_LINE_ALIGNED;  // Tick the car appears on; it is hidden before that
+    int car_wraps[MAX_CARS] CACHE_LINE_ALIGNED;     // Car wraps around instead of bouncing off the edges
+    int car_max_speed[MAX_CARS] CACHE_LINE_ALIGNED; // Top speed for random speed changes, 0 if the speed is fixed
     
-    // Positions, directions, and speeds of friendly cars
-    int friendly_cars_x[MAX_FRIENDLY_CARS], friendly_cars_y[MAX_FRIENDLY_CARS];
-    int friendly_cars_direction[MAX_FRIENDLY_CARS];
-    int friendly_car_speed[MAX_FRIENDLY_CARS];
+    // Positions, directions, and speeds of friendly cars, aligned the same way
+    int num_friendly_cars;
+    int friendly_cars_x[MAX_FRIENDLY_CARS] CACHE_LINE_ALIGNED, friendly_cars_y[MAX_FRIENDLY_CARS] CACHE_LINE_ALIGNED;
+    int friendly_cars_direction[MAX_FRIENDLY_CARS] CACHE_LINE_ALIGNED;
+    int friendly_car_speed[MAX_FRIENDLY_CARS] CACHE_LINE_ALIGNED;
     
     // Positions and states of the coins
     int coins_x[MAX_COINS], coins_y[MAX_COINS];
@@ -30,8 +39,10 @@ typedef struct GameState {
     int obstacles_x[MAX_OBSTACLES], obstacles_y[MAX_OBSTACLES];
     int num_obstacles;
     
-    // States of stopping cars
+    // States of stopping cars, and the indices of the ones that stop so a frog move visits only them
     int stopping_cars[MAX_CARS];
+    int stopping_list[MAX_CARS];
+    int num_stopping;
     
     // Information about the game level, score, and lives
     int level;
@@ -42,11 +53,21 @@ typedef struct GameState {
     time_t start_time;
     time_t last_jump_time;
     
-    // Information about the frog being carried by the stork
+    // Information about the frog being carried and the storks chasing it
     int frog_carried;
     int carrying_car_index;
-    int stork_x, stork_y;
+    int stork_x[MAX_STORKS], stork_y[MAX_STORKS];
+    int num_storks;
+    int stork_interval; // Storks move every stork_interval frog steps
     int frog_steps;
+
+    // Simulation tick counter, counted from the start of the level, and random generator state
+    int tick;
+    unsigned int rng_state;
+
+    // Car and coin events due on later ticks
+    TimerWheel timers;
+    int watched_frog_x, watched_frog_y; // Frog position the stopping cars' next checks assume
 } GameState;
 
 // Function declarations
@@ -61,13 +82,24 @@ void draw_coins(GameState *game_state, Config *config);
 void draw_obstacles(GameState *game_state, Config *config);
 void draw_stork(GameState *game_state, Config *config);
 void move_frog(GameState *game_state, Config *config, int dx, int dy);
+void jump_frog(GameState *game_state, Config *config, int dx, int dy);
+int game_rand(GameState *game_state);
+void update_single_friendly_car(GameState *game_state, Config *config, int i);
+void check_frog_carried(GameState *game_state, int i);
+void update_frog(GameState *game_state);
+void update_enemy_car(GameState *game_state, Config *config, int i);
+void update_enemy_cars(GameState *game_state, Config *config);
 void update_game(GameState *game_state, Config *config);
-int check_collision(GameState *game_state, Config *config);
+int check_collision(GameState *game_state);
 void check_coin_collection(GameState *game_state, Config *config);
 void generate_coins(GameState *game_state, Config *config);
+int coin_count(Config *config);
 void generate_obstacles(GameState *game_state, Config *config);
 void restart_game(GameState *game_state, Config *config);
 void next_level(GameState *game_state, Config *config);
+void start_level(GameState *game_state, Config *config);
+void stop_level_pregen(void);
+void stop_lane_pool(void);
 void display_level(GameState *game_state, Config *config);
 void display_score(GameState *game_state, Config *config);
 void display_lives(GameState *game_state, Config *config);
@@ -75,6 +107,11 @@ void display_timer(GameState *game_state, Config *config);
 void EndGame(const char* info, Config *config);
 void display_game_over(GameState *game_state, Config *config);
 
+// Game loop steps defined in main.c, shared by the serial and pipelined loops
+void draw_game_elements(GameState *game_state, Config *config);
+void check_game_events(GameState *game_state, Config *config);
+void handle_game_key(GameState *game_state, Config *config, int ch);
+
 // Functions for saving and loading the game
 void save_game(GameState *game_state, const char *filename);
 void load_game(GameState *game_state, const char *filename);
@@ -0,0 +1,130 @@
+#include <sched.h>
+#include <unistd.h>
+#include "lanepool.h"
+
+// Function to tell the CPU we are spinning
+static inline void lane_pool_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Function to run one thread's share of the current job
+void lane_pool_share(LanePool *pool, int index) {
+    int begin = index * pool->chunk;
+    int end = (begin + pool->chunk < pool->count) ? begin + pool->chunk : pool->count;
+    if (begin < end) {
+        pool->job(pool->game_state, pool->config, begin, end);
+    }
+}
+
+// Pool thread: wait for a job, run its share, report back
+void* lane_pool_worker(void *arg) {
+    LaneWorker *worker = arg;
+    LanePool *pool = worker->pool;
+    unsigned int seen = 0;
+
+    while (1) {
+        unsigned int generation;
+        int spins = 0;
+        while ((generation = atomic_load_explicit(&pool->generation, memory_order_acquire)) == seen) {
+            if (++spins < LANE_POOL_SPINS) {
+                lane_pool_relax(); // Jobs come in bursts within a tick, so poll first
+                continue;
+            }
+            pthread_mutex_lock(&pool->lock);
+            while (atomic_load_explicit(&pool->generation, memory_order_acquire) == seen) {
+                pthread_cond_wait(&pool->wake, &pool->lock); // Idle between ticks
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+        seen = generation;
+        if (atomic_load(&pool->stopping)) {
+            return NULL;
+        }
+        lane_pool_share(pool, worker->index);
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_release);
+    }
+}
+
+// Function to start the pool threads; threads <= 0 uses every online CPU
+void lane_pool_start(LanePool *pool, int threads) {
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > LANE_POOL_MAX_THREADS) {
+        threads = LANE_POOL_MAX_THREADS;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_store(&pool->generation, 0);
+    atomic_store(&pool->pending, 0);
+    atomic_store(&pool->stopping, 0);
+
+    pool->threads = 1;
+    for (int i = 1; i < threads; i++) {
+        LaneWorker *worker = &pool->workers[pool->threads];
+        worker->pool = pool;
+        worker->index = pool->threads;
+        if (pthread_create(&worker->thread, NULL, lane_pool_worker, worker) != 0) {
+            break; // Run with the threads we have
+        }
+        pool->threads++;
+    }
+}
+
+// Function to run a job over count cars, split into lane ranges across the pool.
+// Small boards run on the calling thread alone. Called from one thread at a time.
+void lane_pool_run(LanePool *pool, LaneJob job, GameState *game_state, Config *config, int count) {
+    int wanted = count / LANE_POOL_MIN_CARS;
+    if (pool->threads == 0 && wanted > 1 && config->lane_threads != 1) {
+        lane_pool_start(pool, config->lane_threads); // First board big enough to share
+    }
+    int threads = (wanted < pool->threads) ? wanted : pool->threads;
+    if (threads <= 1) {
+        job(game_state, config, 0, count);
+        return;
+    }
+
+    pool->job = job;
+    pool->game_state = game_state;
+    pool->config = config;
+    pool->count = count;
+    pool->chunk = ((count + threads - 1) / threads + LANE_POOL_ALIGN - 1) / LANE_POOL_ALIGN * LANE_POOL_ALIGN;
+    atomic_store_explicit(&pool->pending, pool->threads - 1, memory_order_relaxed);
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    lane_pool_share(pool, 0);
+
+    // Barrier: wait for every range before anything reads the board
+    int spins = 0;
+    while (atomic_load_explicit(&pool->pending, memory_order_acquire) > 0) {
+        if (++spins < LANE_POOL_SPINS) {
+            lane_pool_relax();
+        } else {
+            sched_yield(); // More threads than free CPUs
+        }
+    }
+}
+
+// Function to stop and join the pool threads
+void lane_pool_stop(LanePool *pool) {
+    if (pool->threads == 0) {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stopping, 1);
+    atomic_fetch_add_explicit(&pool->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threads; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pool->threads = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef LANEPOOL_H
+#define LANEPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "game.h"
+
+#define LANE_POOL_MAX_THREADS 64
+// Cars per thread below which waking a thread costs more than it saves. kernelcheck -t measured
+// 3.7 ns per car with the AVX2 kernel and 7.9 ns with the scalar one, so the smallest share is
+// 30-65 us of work, ten times a hand-off of a few microseconds. Re-measure the hand-off with the
+// empty job time of kernelcheck -t on a multi-core machine and keep each share above ten of them.
+#define LANE_POOL_MIN_CARS 8192
+#define LANE_POOL_ALIGN 16      // Ranges start on a cache line of car data and fill whole SIMD vectors
+#define LANE_POOL_SPINS 4096    // Polls before a waiting thread yields or sleeps
+
+// The car arrays of GameState start on cache lines, so aligned ranges never share one
+_Static_assert(LANE_POOL_ALIGN * sizeof(int) % CACHE_LINE_SIZE == 0, "LANE_POOL_ALIGN cars must fill whole cache lines");
+
+// LaneJob updates the cars begin..end-1; cars are ordered by lane, so a range is a band of lanes
+typedef void (*LaneJob)(GameState *game_state, Config *config, int begin, int end);
+
+struct LanePool;
+
+// LaneWorker is one pool thread and its share of every job
+typedef struct LaneWorker {
+    pthread_t thread;
+    struct LanePool *pool;
+    int index;
+} LaneWorker;
+
+// LanePool splits car updates by lane range across persistent threads. The calling
+// thread takes the first range and returns once every range is done, so whatever
+// runs after it, such as check_collision, sees the whole board updated.
+typedef struct LanePool {
+    int threads; // Including the calling thread, 0 until the pool is started
+    LaneWorker workers[LANE_POOL_MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_uint generation; // Bumped to hand out a job
+    atomic_int pending;     // Pool threads still working on the current job
+    atomic_int stopping;
+
+    // The current job, written before generation is bumped
+    LaneJob job;
+    GameState *game_state;
+    Config *config;
+    int count, chunk;
+} LanePool;
+
+// Function declarations
+void lane_pool_start(LanePool *pool, int threads);
+void lane_pool_run(LanePool *pool, LaneJob job, GameState *game_state, Config *config, int count);
+void lane_pool_stop(LanePool *pool);
+
+#endif
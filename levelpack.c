@@ -0,0 +1,323 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "levelpack.h"
+
+#define LEVEL_LINE_SIZE 256
+#define LEVEL_FIELD_SIZE 50
+#define LEVEL_WORD_SIZE 16
+
+// Function to report an error in a level source file
+int level_source_error(const char *filename, int line_number, const char *message) {
+    fprintf(stderr, "%s:%d: %s\n", filename, line_number, message);
+    return -1;
+}
+
+// Function to parse "lane=<row> <max_speed> <vary_max_speed> <bounce|wrap> [stop]"
+const char* level_parse_lane(LevelRecord *level, const char *value) {
+    int row, max_speed, vary_max_speed;
+    char mode[LEVEL_WORD_SIZE] = "", extra[LEVEL_WORD_SIZE] = "";
+    if (level->num_lanes >= MAX_PACK_LANES) return "too many lanes";
+    if (sscanf(value, "%d %d %d %15s %15s", &row, &max_speed, &vary_max_speed, mode, extra) < 4) return "expected lane=<row> <max_speed> <vary_max_speed> <bounce|wrap> [stop]";
+    if (row < 0 || max_speed < 1 || max_speed > 255 || vary_max_speed < 0 || vary_max_speed > 255) return "lane value out of range";
+    if (strcmp(mode, "bounce") != 0 && strcmp(mode, "wrap") != 0) return "lane mode must be bounce or wrap";
+    if (extra[0] != '\0' && strcmp(extra, "stop") != 0) return "unknown lane option";
+
+    LevelLane *lane = &level->lanes[level->num_lanes++];
+    lane->row = (int16_t)row;
+    lane->max_speed = (uint8_t)max_speed;
+    lane->vary_max_speed = (uint8_t)vary_max_speed;
+    lane->flags = (uint8_t)((strcmp(mode, "wrap") == 0 ? LANE_WRAPS : 0) | (extra[0] != '\0' ? LANE_STOPS : 0));
+    return NULL;
+}
+
+// Function to parse "friendly=<row> <max_speed>"
+const char* level_parse_friendly(LevelRecord *level, const char *value) {
+    int row, max_speed;
+    if (level->num_friendly >= MAX_PACK_FRIENDLY) return "too many friendly cars";
+    if (sscanf(value, "%d %d", &row, &max_speed) != 2) return "expected friendly=<row> <max_speed>";
+    if (row < 0 || max_speed < 1 || max_speed > 255) return "friendly car value out of range";
+
+    LevelFriendly *friendly = &level->friendly[level->num_friendly++];
+    friendly->row = (int16_t)row;
+    friendly->max_speed = (uint8_t)max_speed;
+    return NULL;
+}
+
+// Function to parse "obstacle=<x> <y>"
+const char* level_parse_obstacle(LevelRecord *level, const char *value) {
+    int x, y;
+    if (level->num_obstacles >= MAX_OBSTACLES) return "too many obstacles";
+    if (sscanf(value, "%d %d", &x, &y) != 2 || x < 0 || y < 0) return "expected obstacle=<x> <y>";
+
+    level->obstacles[level->num_obstacles].x = (int16_t)x;
+    level->obstacles[level->num_obstacles].y = (int16_t)y;
+    level->num_obstacles++;
+    return NULL;
+}
+
+// Function to parse "storks=<count> <every_n_steps>"
+const char* level_parse_storks(LevelRecord *level, const char *value) {
+    int count, interval;
+    if (sscanf(value, "%d %d", &count, &interval) != 2) return "expected storks=<count> <every_n_steps>";
+    if (count < 0 || count > MAX_STORKS || interval < 1 || interval > 255) return "stork value out of range";
+
+    level->num_storks = (uint8_t)count;
+    level->stork_interval = (uint8_t)interval;
+    return NULL;
+}
+
+// Function to parse one key=value entry of a level
+const char* level_parse_entry(LevelRecord *level, const char *key, const char *value) {
+    if (strcmp(key, "lane") == 0) return level_parse_lane(level, value);
+    if (strcmp(key, "friendly") == 0) return level_parse_friendly(level, value);
+    if (strcmp(key, "obstacle") == 0) return level_parse_obstacle(level, value);
+    if (strcmp(key, "storks") == 0) return level_parse_storks(level, value);
+    if (strcmp(key, "random_obstacles") == 0) {
+        level->random_obstacles = (uint8_t)(atoi(value) != 0);
+        return NULL;
+    }
+    return "unknown key";
+}
+
+// Function to check whether a source line is blank or a comment
+int level_line_is_blank(const char *line) {
+    while (*line == ' ' || *line == '\t') line++;
+    return *line == '\0' || *line == '\n' || *line == '\r' || *line == '#';
+}
+
+// Function to parse a level source file into records, returning the level count or -1
+int level_parse_source(const char *source_file, LevelRecord *levels) {
+    FILE *file = fopen(source_file, "r");
+    if (file == NULL) {
+        perror("Error opening level source");
+        return -1;
+    }
+
+    char line[LEVEL_LINE_SIZE], key[LEVEL_FIELD_SIZE], value[LEVEL_FIELD_SIZE];
+    int level_count = 0, line_number = 0, result = 0;
+    while (result == 0) {
+        read_line(file, line, sizeof(line));
+        if (line[0] == '\0') break; // End of file or error
+        line_number++;
+        if (level_line_is_blank(line)) continue;
+
+        key[0] = value[0] = '\0';
+        parse_line(line, key, value);
+        if (strcmp(key, "level") == 0) { // Every level starts with a level= line
+            if (level_count >= MAX_PACK_LEVELS) {
+                result = level_source_error(source_file, line_number, "too many levels");
+            } else {
+                memset(&levels[level_count++], 0, sizeof(LevelRecord));
+            }
+        } else if (level_count == 0) {
+            result = level_source_error(source_file, line_number, "entry before the first level= line");
+        } else {
+            const char *error = level_parse_entry(&levels[level_count - 1], key, value);
+            if (error != NULL) {
+                result = level_source_error(source_file, line_number, error);
+            }
+        }
+    }
+    fclose(file);
+    return (result == 0) ? level_count : -1;
+}
+
+// Function to compile a level source file into a binary level pack
+int level_pack_compile(const char *source_file, const char *pack_file) {
+    static LevelRecord levels[MAX_PACK_LEVELS];
+    int level_count = level_parse_source(source_file, levels);
+    if (level_count < 0) {
+        return -1;
+    }
+    if (level_count == 0) {
+        fprintf(stderr, "%s: no levels defined\n", source_file);
+        return -1;
+    }
+
+    LevelPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_PACK_MAGIC, sizeof(header.magic));
+    header.version = LEVEL_PACK_VERSION;
+    header.record_size = sizeof(LevelRecord);
+    header.level_count = (uint32_t)level_count;
+
+    // Write to a temporary file first so a running game never maps a half-written pack
+    char temp_file[LEVEL_LINE_SIZE];
+    snprintf(temp_file, sizeof(temp_file), "%s.tmp", pack_file);
+    FILE *file = fopen(temp_file, "wb");
+    if (file == NULL) {
+        perror("Error opening level pack for writing");
+        return -1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(levels, sizeof(LevelRecord), (size_t)level_count, file) == (size_t)level_count;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(temp_file, pack_file) != 0) {
+        perror("Error writing level pack");
+        remove(temp_file);
+        return -1;
+    }
+    printf("Compiled %d levels into %s\n", level_count, pack_file);
+    return 0;
+}
+
+// Function to check that a level record stays within the game state arrays and has usable speeds
+int level_record_validate(const LevelRecord *level) {
+    int lanes = level->num_lanes, friendly = level->num_friendly; // Widened, since the caps may equal the 8-bit limit
+    if (lanes > MAX_PACK_LANES || friendly > MAX_PACK_FRIENDLY ||
+        level->num_obstacles > MAX_OBSTACLES || level->num_storks > MAX_STORKS || level->stork_interval < 1) {
+        return 0;
+    }
+    for (int i = 0; i < level->num_lanes; i++) {
+        if (level->lanes[i].max_speed < 1) {
+            return 0; // Starting speeds are drawn modulo max_speed
+        }
+    }
+    for (int i = 0; i < level->num_friendly; i++) {
+        if (level->friendly[i].max_speed < 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function to check that a mapped file is a level pack this build can read
+int level_pack_validate(const void *data, size_t size) {
+    const LevelPackHeader *header = data;
+    if (size < sizeof(LevelPackHeader) || memcmp(header->magic, LEVEL_PACK_MAGIC, sizeof(header->magic)) != 0) {
+        return 0;
+    }
+    if (header->version != LEVEL_PACK_VERSION || header->record_size != sizeof(LevelRecord)) {
+        return 0; // Written by an incompatible build, recompile the pack
+    }
+    if (header->level_count == 0 || header->level_count > MAX_PACK_LEVELS ||
+        size < sizeof(LevelPackHeader) + header->level_count * sizeof(LevelRecord)) {
+        return 0;
+    }
+    const LevelRecord *levels = (const LevelRecord *)((const char *)data + sizeof(LevelPackHeader));
+    for (uint32_t i = 0; i < header->level_count; i++) {
+        if (!level_record_validate(&levels[i])) {
+            return 0; // A damaged or hand-edited record would overrun the game state
+        }
+    }
+    return 1;
+}
+
+// Function to map a level pack file into memory
+LevelPack* level_pack_open(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening level pack");
+        return NULL;
+    }
+    struct stat info;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error mapping level pack %s\n", filename);
+        return NULL;
+    }
+    if (!level_pack_validate(data, (size_t)info.st_size)) {
+        fprintf(stderr, "Invalid level pack %s, recompile it with --compile-levels\n", filename);
+        munmap(data, (size_t)info.st_size);
+        return NULL;
+    }
+
+    LevelPack *pack = malloc(sizeof(LevelPack));
+    if (pack == NULL) {
+        munmap(data, (size_t)info.st_size);
+        return NULL;
+    }
+    pack->data = data;
+    pack->size = (size_t)info.st_size;
+    pack->header = data;
+    pack->levels = (const LevelRecord *)((const char *)data + sizeof(LevelPackHeader));
+    return pack;
+}
+
+// Function to unmap a level pack
+void level_pack_close(LevelPack *pack) {
+    if (pack != NULL) {
+        munmap(pack->data, pack->size);
+        free(pack);
+    }
+}
+
+// Function to get the number of levels in a pack, 0 if no pack is loaded
+int level_pack_count(const LevelPack *pack) {
+    return (pack != NULL) ? (int)pack->header->level_count : 0;
+}
+
+// Function to clamp a coordinate from the pack to the screen
+int level_clamp(int value, int low, int high) {
+    if (value > high) value = high;
+    if (value < low) value = low;
+    return value;
+}
+
+// Function to place the enemy cars of a level
+void level_pack_apply_cars(const LevelRecord *level, GameState *game_state, Config *config) {
+    game_state->num_cars = level->num_lanes;
+    for (int i = 0; i < level->num_lanes; i++) {
+        const LevelLane *lane = &level->lanes[i];
+        game_state->cars_x[i] = game_rand(game_state) % config->screen_width;
+        game_state->cars_y[i] = level_clamp(lane->row, 0, config->screen_height - 1);
+        game_state->cars_direction[i] = (game_rand(game_state) % 2 == 0) ? 1 : -1; // Randomize car direction
+        game_state->car_speed[i] = game_rand(game_state) % lane->max_speed + 1;
+        game_state->car_spawn_tick[i] = game_state->tick + game_rand(game_state) % 10 + 1; // Randomize spawn delay
+        game_state->car_wraps[i] = (lane->flags & LANE_WRAPS) != 0;
+        game_state->car_max_speed[i] = lane->vary_max_speed;
+        game_state->stopping_cars[i] = (lane->flags & LANE_STOPS) != 0;
+    }
+}
+
+// Function to place the friendly cars of a level
+void level_pack_apply_friendly_cars(const LevelRecord *level, GameState *game_state, Config *config) {
+    game_state->num_friendly_cars = level->num_friendly;
+    for (int i = 0; i < level->num_friendly; i++) {
+        game_state->friendly_cars_x[i] = game_rand(game_state) % config->screen_width;
+        game_state->friendly_cars_y[i] = level_clamp(level->friendly[i].row, 0, config->screen_height - 1);
+        game_state->friendly_cars_direction[i] = (game_rand(game_state) % 2 == 0) ? 1 : -1; // Randomize direction
+        game_state->friendly_car_speed[i] = game_rand(game_state) % level->friendly[i].max_speed + 1;
+    }
+}
+
+// Function to place the storks of a level along the bottom row
+void level_pack_apply_storks(const LevelRecord *level, GameState *game_state, Config *config) {
+    game_state->num_storks = level->num_storks;
+    game_state->stork_interval = level->stork_interval;
+    int spacing = (level->num_storks > 0) ? config->screen_width / (2 * level->num_storks) : 0;
+    for (int i = 0; i < level->num_storks; i++) {
+        game_state->stork_x[i] = config->screen_width - 1 - i * spacing; // Spread storks from the right edge
+        game_state->stork_y[i] = config->screen_height - 2;
+    }
+}
+
+// Function to instantiate the current level from the pack, returning 0 if the pack does not define it
+int level_pack_apply(const LevelPack *pack, GameState *game_state, Config *config) {
+    if (game_state->level < 1 || game_state->level > level_pack_count(pack)) {
+        return 0;
+    }
+    const LevelRecord *level = &pack->levels[game_state->level - 1];
+
+    level_pack_apply_cars(level, game_state, config);
+    level_pack_apply_friendly_cars(level, game_state, config);
+    level_pack_apply_storks(level, game_state, config);
+    if (level->random_obstacles) {
+        generate_obstacles(game_state, config);
+    } else {
+        game_state->num_obstacles = level->num_obstacles;
+        for (int i = 0; i < level->num_obstacles; i++) {
+            game_state->obstacles_x[i] = level_clamp(level->obstacles[i].x, 0, config->screen_width - 3); // Obstacles are 3 cells wide
+            game_state->obstacles_y[i] = level_clamp(level->obstacles[i].y, 0, config->screen_height - 1);
+        }
+    }
+    return 1;
+}
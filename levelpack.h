@@ -0,0 +1,79 @@
+#ifndef LEVELPACK_H
+#define LEVELPACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+
+#define LEVEL_PACK_MAGIC "FROGPAK1"
+#define LEVEL_PACK_VERSION 1
+#define MAX_PACK_LEVELS 255
+#define MAX_PACK_LANES ((MAX_CARS < 255) ? MAX_CARS : 255)                       // Lane counts are stored in 8 bits
+#define MAX_PACK_FRIENDLY ((MAX_FRIENDLY_CARS < 255) ? MAX_FRIENDLY_CARS : 255) // Friendly car counts too
+
+// Lane flags stored in LevelLane.flags
+#define LANE_WRAPS 0x01 // Car wraps around instead of bouncing off the edges
+#define LANE_STOPS 0x02 // Car stops when the frog comes near
+
+// LevelLane describes the enemy car driving on one row
+typedef struct LevelLane {
+    int16_t row;
+    uint8_t max_speed;      // Starting speed is picked from 1..max_speed
+    uint8_t vary_max_speed; // Top speed for random speed changes, 0 if the speed is fixed
+    uint8_t flags;
+    uint8_t reserved[3];
+} LevelLane;
+
+// LevelFriendly describes one friendly car
+typedef struct LevelFriendly {
+    int16_t row;
+    uint8_t max_speed;
+    uint8_t reserved;
+} LevelFriendly;
+
+// LevelObstacle is the top-left cell of a 3-wide obstacle
+typedef struct LevelObstacle {
+    int16_t x, y;
+} LevelObstacle;
+
+// LevelRecord is one level of the pack. Records have a fixed size and are used
+// straight from the mapped file, so instantiating a level needs no parsing.
+typedef struct LevelRecord {
+    uint8_t num_lanes;
+    uint8_t num_friendly;
+    uint8_t num_obstacles;
+    uint8_t random_obstacles; // Place obstacles at random instead of using the list
+    uint8_t num_storks;
+    uint8_t stork_interval;   // Storks move every stork_interval frog steps
+    uint8_t reserved[2];
+    LevelLane lanes[MAX_PACK_LANES];
+    LevelFriendly friendly[MAX_PACK_FRIENDLY];
+    LevelObstacle obstacles[MAX_OBSTACLES];
+} LevelRecord;
+
+// LevelPackHeader starts the file and is followed by level_count records
+typedef struct LevelPackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size; // sizeof(LevelRecord) of the build that wrote the pack
+    uint32_t level_count;
+    uint32_t reserved;
+} LevelPackHeader;
+
+// LevelPack is a level pack file mapped into memory
+typedef struct LevelPack {
+    void *data;
+    size_t size;
+    const LevelPackHeader *header;
+    const LevelRecord *levels;
+} LevelPack;
+
+// Function declarations
+int level_pack_compile(const char *source_file, const char *pack_file);
+LevelPack* level_pack_open(const char *filename);
+void level_pack_close(LevelPack *pack);
+int level_pack_count(const LevelPack *pack);
+int level_pack_apply(const LevelPack *pack, GameState *game_state, Config *config);
+
+#endif
@@ -1,9 +1,15 @@
 #include <ncurses.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
 #include <unistd.h>
 #include "config.h"
 #include "game.h"
+#include "levelpack.h"
+#include "pipeline.h"
+#include "scores.h"
+#include "trace.h"
+#include "versus.h"
 
 // Initialize the game state and configuration settings
 void init_game(GameState* game_state, Config* config) {
@@ -16,36 +22,43 @@ void init_game(GameState* game_state, Config* config) {
     game_state->lives = 3;
     game_state->start_time = time(NULL);
     game_state->last_jump_time = time(NULL);
+    game_state->rng_state = (unsigned int)time(NULL);
 }
 
 // Function prototypes
-void draw_game_elements(GameState* game_state, Config* config);
-void check_game_events(GameState* game_state, Config* config);
 void process_game_input(GameState* game_state, Config* config);
 
 // The main game loop that handles the game progression and logic
 void main_game_loop(GameState* game_state, Config* config) {
+    start_level(game_state, config);
     while (game_state->lives > 0) {
-        restart_game(game_state, config);
-
-        while (1) {
-            clear();
-            getmaxyx(stdscr, config->screen_height, config->screen_width);
-            draw_game_elements(game_state, config);
-            check_game_events(game_state, config);
-            process_game_input(game_state, config);
-
-            if (game_state->lives == 0) {
-                break; // End the loop if the player has no lives left
-            }
-            if (game_state->frog_y == 1) {
-                game_state->score += 5;
-                next_level(game_state, config); // Proceed to the next level
-                break;
-            }
-            refresh();
-            usleep(1000); // Pause to reduce refresh rate
+        TRACE_BEGIN("clear");
+        clear();
+        getmaxyx(stdscr, config->screen_height, config->screen_width);
+        TRACE_END("clear");
+        TRACE_BEGIN("draw_game_elements");
+        draw_game_elements(game_state, config);
+        TRACE_END("draw_game_elements");
+        TRACE_BEGIN("check_game_events");
+        check_game_events(game_state, config);
+        TRACE_END("check_game_events");
+        TRACE_BEGIN("process_game_input");
+        process_game_input(game_state, config);
+        TRACE_END("process_game_input");
+
+        if (game_state->lives == 0) {
+            break; // End the loop if the player has no lives left
+        }
+        if (game_state->frog_y == 1) {
+            game_state->score += 5;
+            next_level(game_state, config); // Swap in the next level, generated in the background
         }
+        TRACE_BEGIN("refresh");
+        refresh();
+        TRACE_END("refresh");
+        TRACE_BEGIN("sleep");
+        usleep(1000); // Pause to reduce refresh rate
+        TRACE_END("sleep");
     }
 }
 
@@ -58,9 +71,7 @@ void draw_game_elements(GameState* game_state, Config* config) {
     draw_friendly_cars(game_state, config);
     draw_coins(game_state, config);
     draw_obstacles(game_state, config);
-    if (game_state->level >= 2) {
     draw_stork(game_state, config);
-    }
     display_level(game_state, config);
     display_score(game_state, config);
     display_lives(game_state, config);
@@ -72,7 +83,7 @@ void check_game_events(GameState* game_state, Config* config) {
     update_game(game_state, config);
     check_coin_collection(game_state, config);
 
-    if (check_collision(game_state, config)) {
+    if (check_collision(game_state)) {
         game_state->lives--; // Reduce lives on collision
         game_state->frog_x = config->screen_width / 2; // Reset frog position
         game_state->frog_y = config->screen_height - 2;
@@ -84,12 +95,24 @@ void process_game_input(GameState* game_state, Config* config) {
     int ch = getch();
     if (ch == 'q') {
         printf("Saving game...\n");
-        save_game(game_state, "savegame.dat");
+        handle_game_key(game_state, config, ch);
         printf("Game saved.\n");
     } else if (ch == 'l') {
         printf("Loading game...\n");
-        load_game(game_state, "savegame.dat");
+        handle_game_key(game_state, config, ch);
         printf("Game loaded.\n");
+    } else {
+        handle_game_key(game_state, config, ch);
+    }
+}
+
+// Apply a single key press to the game. It prints nothing, since in pipelined mode
+// it runs on the simulation thread while the render thread owns the terminal.
+void handle_game_key(GameState* game_state, Config* config, int ch) {
+    if (ch == 'q') {
+        save_game(game_state, "savegame.dat");
+    } else if (ch == 'l') {
+        load_game(game_state, "savegame.dat");
     } else if (ch == KEY_UP) {
         move_frog(game_state, config, 0, -1); // Move frog up
     } else if (ch == KEY_DOWN) {
@@ -101,14 +124,106 @@ void process_game_input(GameState* game_state, Config* config) {
     }
 }
 
+// Record the finished game in the score log without holding up exit
+void record_score(GameState* game_state) {
+    ScoreRecord record;
+    score_record_init(&record, game_state->score, game_state->level, (int)difftime(time(NULL), game_state->start_time));
+    score_store_append_async(SCORE_LOG_FILE, SCORE_INDEX_FILE, &record);
+}
+
+// Print a leaderboard for --top K [--level N | --day YYYY-MM-DD]
+int show_leaderboard(int argc, char *argv[]) {
+    int k = atoi(argv[2]);
+    int board = SCORES_GLOBAL, key = 0;
+    if (argc == 5 && strcmp(argv[3], "--level") == 0) {
+        board = SCORES_BY_LEVEL;
+        key = atoi(argv[4]);
+    } else if (argc == 5 && strcmp(argv[3], "--day") == 0) {
+        struct tm day = {0};
+        if (sscanf(argv[4], "%d-%d-%d", &day.tm_year, &day.tm_mon, &day.tm_mday) != 3) {
+            fprintf(stderr, "Expected a date like 2024-06-30.\n");
+            return 1;
+        }
+        day.tm_year -= 1900;
+        day.tm_mon -= 1;
+        board = SCORES_BY_DAY;
+        key = (int)(timegm(&day) / 86400);
+    } else if (argc != 3) {
+        fprintf(stderr, "Usage: --top K [--level N | --day YYYY-MM-DD]\n");
+        return 1;
+    }
+    if (k <= 0) {
+        return 0;
+    }
+
+    ScoreRecord *top = malloc((size_t)k * sizeof(ScoreRecord));
+    if (top == NULL) {
+        return 1;
+    }
+    int count = score_store_top(SCORE_LOG_FILE, SCORE_INDEX_FILE, board, key, top, k);
+    for (int i = 0; i < count; i++) {
+        char date[16];
+        time_t finished_at = (time_t)top[i].finished_at;
+        strftime(date, sizeof(date), "%Y-%m-%d", gmtime(&finished_at));
+        printf("%3d. %6d points  level %d  %s  %d seconds\n", i + 1, top[i].score, top[i].level, date, top[i].seconds_played);
+    }
+    free(top);
+    return 0;
+}
+
+// Start a two-player versus match against another process on a local socket
+int start_versus(const char *mode, const char *socket_path, Config *config) {
+    int local_player = (strcmp(mode, "--host") == 0) ? 0 : 1;
+    int fd = (local_player == 0) ? versus_host(socket_path) : versus_join(socket_path);
+    if (fd < 0) {
+        return 1;
+    }
+
+    Start(config);
+    keypad(stdscr, TRUE);
+    getmaxyx(stdscr, config->screen_height, config->screen_width);
+    run_versus(fd, local_player, config);
+    close(fd);
+    stop_level_pregen();
+    stop_lane_pool(); // Large boards start the pool; join it before exit runs trace_write
+    endwin();
+    return 0;
+}
+
 // Main function to start the game
-int main() {
-    GameState game_state = {0};
-    Config config;
+int main(int argc, char *argv[]) {
+    static GameState game_state; // Static, since a -DMAX_CARS build can make it too big for the stack
+    Config config = {0};
 
+    if (argc >= 3 && strcmp(argv[1], "--top") == 0) {
+        return show_leaderboard(argc, argv);
+    }
+    if (argc == 4 && strcmp(argv[1], "--compile-levels") == 0) {
+        return level_pack_compile(argv[2], argv[3]) == 0 ? 0 : 1;
+    }
+    if (getenv("FROG_TRACE") != NULL) {
+        trace_start(getenv("FROG_TRACE")); // Record spans and write them as Chrome trace JSON on exit
+    }
+    trace_thread_name("main");
     load_config("config.txt", &config);
+    if (config.level_pack_file[0] != '\0') {
+        config.level_pack = level_pack_open(config.level_pack_file); // Falls back to the built-in levels on error
+    }
+    if (argc == 3 && (strcmp(argv[1], "--host") == 0 || strcmp(argv[1], "--join") == 0)) {
+        return start_versus(argv[1], argv[2], &config);
+    }
+    int pipelined = 0, skip_screens = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = 1;
+        } else if (strcmp(argv[i], "--skip-screens") == 0) {
+            skip_screens = 1; // No welcome or game over screen to wait on, for unattended runs like tools/latency.c
+        }
+    }
     WINDOW* mainwin = Start(&config);
-    Welcome(mainwin);
+    if (!skip_screens) {
+        Welcome(mainwin);
+    }
 
     initscr();
     noecho();
@@ -123,9 +238,19 @@ int main() {
     }
 
     init_game(&game_state, &config);
-    main_game_loop(&game_state, &config);
+    if (pipelined) {
+        run_pipelined_game(&game_state, &config); // Input, simulation and drawing on separate threads
+    } else {
+        main_game_loop(&game_state, &config);
+    }
     
-    display_game_over(&game_state, &config);
+    stop_level_pregen();
+    stop_lane_pool();
+    record_score(&game_state);
+    if (!skip_screens) {
+        display_game_over(&game_state, &config);
+    }
     endwin();
+    level_pack_close(config.level_pack);
     return 0;
 }
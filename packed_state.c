@@ -0,0 +1,165 @@
+#include <string.h>
+#include "packed_state.h"
+
+// Function to read one bit of a packed bitset
+int packed_bit(const uint32_t *bits, int i) {
+    return (int)((bits[i / 32] >> (i % 32)) & 1u);
+}
+
+// Function to set one bit of a packed bitset
+void packed_set_bit(uint32_t *bits, int i, int value) {
+    if (value) {
+        bits[i / 32] |= 1u << (i % 32);
+    }
+}
+
+// Function to pack the simulated part of the game state
+void pack_state(const GameState *game_state, PackedState *packed) {
+    memset(packed, 0, sizeof(*packed)); // Zero padding so hashing and comparing see only real data
+
+    packed->num_cars = (uint32_t)game_state->num_cars;
+    for (int i = 0; i < MAX_CARS; i++) {
+        packed->cars_x[i] = (int16_t)game_state->cars_x[i];
+        packed->cars_y[i] = (int32_t)game_state->cars_y[i];
+        packed->cars_direction[i] = (int8_t)game_state->cars_direction[i];
+        packed->car_speed[i] = (uint8_t)game_state->car_speed[i];
+        int delay = game_state->car_spawn_tick[i] - game_state->tick;
+        packed->car_spawn_delay[i] = (uint8_t)(delay > 0 ? delay : 0);
+        packed->car_max_speed[i] = (uint8_t)game_state->car_max_speed[i];
+        packed_set_bit(packed->stopping_cars, i, game_state->stopping_cars[i]);
+        packed_set_bit(packed->car_wraps, i, game_state->car_wraps[i]);
+    }
+    packed->num_friendly_cars = (uint32_t)game_state->num_friendly_cars;
+    for (int i = 0; i < MAX_FRIENDLY_CARS; i++) {
+        packed->friendly_cars_x[i] = (int16_t)game_state->friendly_cars_x[i];
+        packed->friendly_cars_y[i] = (int16_t)game_state->friendly_cars_y[i];
+        packed->friendly_cars_direction[i] = (int8_t)game_state->friendly_cars_direction[i];
+        packed->friendly_car_speed[i] = (uint8_t)game_state->friendly_car_speed[i];
+    }
+    for (int i = 0; i < MAX_COINS; i++) {
+        packed->coins_x[i] = (int16_t)game_state->coins_x[i];
+        packed->coins_y[i] = (int16_t)game_state->coins_y[i];
+        packed_set_bit(packed->coins_collected, i, game_state->coins_collected[i]);
+    }
+    for (int i = 0; i < MAX_OBSTACLES; i++) {
+        packed->obstacles_x[i] = (int16_t)game_state->obstacles_x[i];
+        packed->obstacles_y[i] = (int16_t)game_state->obstacles_y[i];
+    }
+    packed->num_obstacles = (uint16_t)game_state->num_obstacles;
+
+    packed->frog_x = (int16_t)game_state->frog_x;
+    packed->frog_y = (int16_t)game_state->frog_y;
+    for (int i = 0; i < MAX_STORKS; i++) {
+        packed->stork_x[i] = (int16_t)game_state->stork_x[i];
+        packed->stork_y[i] = (int16_t)game_state->stork_y[i];
+    }
+    packed->num_storks = (uint8_t)game_state->num_storks;
+    packed->stork_interval = (uint8_t)game_state->stork_interval;
+    packed->frog_steps = (uint16_t)game_state->frog_steps; // Only the parity of the step count matters
+    packed->carrying_car_index = (int16_t)game_state->carrying_car_index;
+    packed->frog_carried = (uint8_t)game_state->frog_carried;
+    packed->level = (uint8_t)game_state->level;
+    packed->lives = (uint8_t)game_state->lives;
+    packed->score = game_state->score;
+    packed->tick = (uint32_t)game_state->tick;
+    packed->rng_state = game_state->rng_state;
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        packed->timer_due[i] = game_state->timers.due[i];
+    }
+    packed->watched_frog_x = (int16_t)game_state->watched_frog_x;
+    packed->watched_frog_y = (int16_t)game_state->watched_frog_y;
+}
+
+// Function to restore the simulated part of the game state, leaving its wall-clock times untouched
+void unpack_state(const PackedState *packed, GameState *game_state) {
+    game_state->tick = (int)packed->tick;
+    game_state->num_cars = packed->num_cars;
+    game_state->num_stopping = 0;
+    for (int i = 0; i < MAX_CARS; i++) {
+        game_state->cars_x[i] = packed->cars_x[i];
+        game_state->cars_y[i] = packed->cars_y[i];
+        game_state->cars_direction[i] = packed->cars_direction[i];
+        game_state->car_speed[i] = packed->car_speed[i];
+        game_state->car_spawn_tick[i] = game_state->tick + packed->car_spawn_delay[i];
+        game_state->car_max_speed[i] = packed->car_max_speed[i];
+        game_state->stopping_cars[i] = packed_bit(packed->stopping_cars, i);
+        if (game_state->stopping_cars[i] && i < game_state->num_cars) {
+            game_state->stopping_list[game_state->num_stopping++] = i;
+        }
+        game_state->car_wraps[i] = packed_bit(packed->car_wraps, i);
+    }
+    game_state->num_friendly_cars = packed->num_friendly_cars;
+    for (int i = 0; i < MAX_FRIENDLY_CARS; i++) {
+        game_state->friendly_cars_x[i] = packed->friendly_cars_x[i];
+        game_state->friendly_cars_y[i] = packed->friendly_cars_y[i];
+        game_state->friendly_cars_direction[i] = packed->friendly_cars_direction[i];
+        game_state->friendly_car_speed[i] = packed->friendly_car_speed[i];
+    }
+    for (int i = 0; i < MAX_COINS; i++) {
+        game_state->coins_x[i] = packed->coins_x[i];
+        game_state->coins_y[i] = packed->coins_y[i];
+        game_state->coins_collected[i] = packed_bit(packed->coins_collected, i);
+    }
+    for (int i = 0; i < MAX_OBSTACLES; i++) {
+        game_state->obstacles_x[i] = packed->obstacles_x[i];
+        game_state->obstacles_y[i] = packed->obstacles_y[i];
+    }
+    game_state->num_obstacles = packed->num_obstacles;
+
+    game_state->frog_x = packed->frog_x;
+    game_state->frog_y = packed->frog_y;
+    for (int i = 0; i < MAX_STORKS; i++) {
+        game_state->stork_x[i] = packed->stork_x[i];
+        game_state->stork_y[i] = packed->stork_y[i];
+    }
+    game_state->num_storks = packed->num_storks;
+    game_state->stork_interval = packed->stork_interval;
+    game_state->frog_steps = packed->frog_steps;
+    game_state->carrying_car_index = packed->carrying_car_index;
+    game_state->frog_carried = packed->frog_carried;
+    game_state->level = packed->level;
+    game_state->lives = packed->lives;
+    game_state->score = packed->score;
+    game_state->rng_state = packed->rng_state;
+    timer_wheel_init(&game_state->timers, game_state->tick);
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        if (packed->timer_due[i] != TIMER_NONE) {
+            timer_wheel_schedule(&game_state->timers, i, packed->timer_due[i]);
+        }
+    }
+    game_state->watched_frog_x = packed->watched_frog_x;
+    game_state->watched_frog_y = packed->watched_frog_y;
+}
+
+// Function to hash a packed state with 64-bit FNV-1a
+uint64_t packed_state_hash(const PackedState *packed) {
+    const unsigned char *bytes = (const unsigned char *)packed;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(*packed); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Function to check whether two packed states are identical
+int packed_state_equal(const PackedState *a, const PackedState *b) {
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+// Function to copy one packed state into another
+void packed_state_copy(PackedState *dst, const PackedState *src) {
+    memcpy(dst, src, sizeof(*dst));
+}
+
+// Function to fill in the save file header for this build
+void save_header_init(SaveHeader *header) {
+    header->magic = SAVE_MAGIC;
+    header->version = SAVE_VERSION;
+    header->state_size = (uint32_t)sizeof(PackedState);
+}
+
+// Function to check that a save file header was written by this build
+int save_header_valid(const SaveHeader *header) {
+    return header->magic == SAVE_MAGIC && header->version == SAVE_VERSION && header->state_size == sizeof(PackedState);
+}
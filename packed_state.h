@@ -0,0 +1,82 @@
+#ifndef PACKED_STATE_H
+#define PACKED_STATE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+
+#define PACKED_BITSET_WORDS(n) (((n) + 31) / 32)
+
+// Friendly car indices are packed into 16 bits
+_Static_assert(MAX_FRIENDLY_CARS <= INT16_MAX, "MAX_FRIENDLY_CARS does not fit carrying_car_index");
+#define SAVE_MAGIC 0x474f5246u // "FROG" when read back on a little-endian machine
+#define SAVE_VERSION 3         // Bump whenever the PackedState layout changes
+
+// PackedState is a compact copy of the simulated part of GameState, used for
+// snapshots, hashing and saving. Wall-clock fields are not part of it; the
+// simulation is timed by the tick counter instead.
+typedef struct PackedState {
+    // Positions, directions, speeds and spawn delays of the cars
+    uint32_t num_cars;
+    int16_t cars_x[MAX_CARS];
+    int32_t cars_y[MAX_CARS]; // Car i starts on row 2 + 2i, past int16 on large boards
+    int8_t cars_direction[MAX_CARS];
+    uint8_t car_speed[MAX_CARS];
+    uint8_t car_spawn_delay[MAX_CARS]; // Ticks until each car appears, 0 once it is visible
+    uint8_t car_max_speed[MAX_CARS];
+
+    // Positions, directions and speeds of friendly cars
+    uint32_t num_friendly_cars;
+    int16_t friendly_cars_x[MAX_FRIENDLY_CARS], friendly_cars_y[MAX_FRIENDLY_CARS];
+    int8_t friendly_cars_direction[MAX_FRIENDLY_CARS];
+    uint8_t friendly_car_speed[MAX_FRIENDLY_CARS];
+
+    // Positions of coins and obstacles
+    int16_t coins_x[MAX_COINS], coins_y[MAX_COINS];
+    int16_t obstacles_x[MAX_OBSTACLES], obstacles_y[MAX_OBSTACLES];
+    uint16_t num_obstacles;
+
+    // Flags stored one bit per coin or car
+    uint32_t coins_collected[PACKED_BITSET_WORDS(MAX_COINS)];
+    uint32_t stopping_cars[PACKED_BITSET_WORDS(MAX_CARS)];
+    uint32_t car_wraps[PACKED_BITSET_WORDS(MAX_CARS)];
+
+    // Frog, storks and progress
+    int16_t frog_x, frog_y;
+    int16_t stork_x[MAX_STORKS], stork_y[MAX_STORKS];
+    uint8_t num_storks;
+    uint8_t stork_interval;
+    uint16_t frog_steps;
+    int16_t carrying_car_index;
+    uint8_t frog_carried;
+    uint8_t level;
+    uint8_t lives;
+    int32_t score;
+
+    // Simulation tick counter and random generator state
+    uint32_t tick;
+    uint32_t rng_state;
+
+    // Pending car and coin events; the timer wheel is rebuilt from them
+    int32_t timer_due[MAX_TIMERS];
+    int16_t watched_frog_x, watched_frog_y;
+} PackedState;
+
+// SaveHeader starts every save file, so files from another version or
+// another MAX_CARS build are rejected instead of misread
+typedef struct SaveHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t state_size; // sizeof(PackedState) of the build that wrote the file
+} SaveHeader;
+
+// Function declarations
+void pack_state(const GameState *game_state, PackedState *packed);
+void unpack_state(const PackedState *packed, GameState *game_state);
+uint64_t packed_state_hash(const PackedState *packed);
+int packed_state_equal(const PackedState *a, const PackedState *b);
+void packed_state_copy(PackedState *dst, const PackedState *src);
+void save_header_init(SaveHeader *header);
+int save_header_valid(const SaveHeader *header);
+
+#endif
@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "pipeline.h"
+#include "trace.h"
+
+#define TRIPLE_BUFFER_FRESH 4
+
+// Pipeline is the state shared by the input, simulation and render threads
+typedef struct Pipeline {
+    Config *config;         // Read-only while the threads run
+    GameState *game_state;  // Owned by the simulation thread
+    KeyQueue keys;
+    pthread_mutex_t key_lock;
+    pthread_cond_t key_arrived; // Signalled by the input thread, timed on CLOCK_MONOTONIC
+    TripleBuffer frames;
+    atomic_int running;
+} Pipeline;
+
+// Function to get a monotonic timestamp in microseconds
+long long pipeline_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Function to add a key press to the queue, returning 0 if the queue is full
+int key_queue_push(KeyQueue *queue, int key) {
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == KEY_QUEUE_SIZE) {
+        return 0; // Full, drop the key
+    }
+    queue->keys[tail & (KEY_QUEUE_SIZE - 1)] = key;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+// Function to take the oldest key press from the queue, returning 0 if it is empty
+int key_queue_pop(KeyQueue *queue, int *key) {
+    unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return 0;
+    }
+    *key = queue->keys[head & (KEY_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return 1;
+}
+
+// Function to check whether the queue has no key presses waiting
+int key_queue_empty(KeyQueue *queue) {
+    return atomic_load_explicit(&queue->head, memory_order_relaxed) == atomic_load_explicit(&queue->tail, memory_order_acquire);
+}
+
+// Function to fill every slot of the triple buffer with the starting state
+void triple_buffer_init(TripleBuffer *buffer, const GameState *game_state) {
+    for (int i = 0; i < 3; i++) {
+        buffer->slots[i] = *game_state;
+    }
+    buffer->back = 0;
+    atomic_store(&buffer->middle, 1);
+    buffer->front = 2;
+}
+
+// Function to publish a completed state and take the spare slot for the next one
+void triple_buffer_publish(TripleBuffer *buffer, const GameState *game_state) {
+    buffer->slots[buffer->back] = *game_state;
+    int previous = atomic_exchange_explicit(&buffer->middle, buffer->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel);
+    buffer->back = previous & 3;
+}
+
+// Function to get the latest published state, swapping it in if it has not been read yet
+GameState* triple_buffer_latest(TripleBuffer *buffer, int *fresh) {
+    *fresh = (atomic_load_explicit(&buffer->middle, memory_order_acquire) & TRIPLE_BUFFER_FRESH) != 0;
+    if (*fresh) {
+        int previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+        buffer->front = previous & 3;
+    }
+    return &buffer->slots[buffer->front];
+}
+
+// Function to turn raw terminal bytes into key codes, following arrow-key escape sequences
+int decode_key_byte(int *escape_state, unsigned char byte) {
+    static const int arrows[] = { KEY_UP, KEY_DOWN, KEY_RIGHT, KEY_LEFT };
+
+    if (*escape_state == 0 && byte == 27) {
+        *escape_state = 1;
+        return ERR;
+    }
+    if (*escape_state == 1 && (byte == '[' || byte == 'O')) {
+        *escape_state = 2;
+        return ERR;
+    }
+    if (*escape_state == 2) {
+        *escape_state = 0;
+        return (byte >= 'A' && byte <= 'D') ? arrows[byte - 'A'] : ERR;
+    }
+    *escape_state = 0;
+    return byte;
+}
+
+// Input thread: read the terminal directly so key presses never wait for drawing
+void* pipeline_input_thread(void *arg) {
+    Pipeline *pipeline = arg;
+    trace_thread_name("input");
+    int escape_state = 0;
+
+    while (atomic_load(&pipeline->running)) {
+        struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+        if (poll(&input, 1, 50) <= 0) {
+            continue; // Wake up regularly to notice the end of the game
+        }
+        unsigned char bytes[32];
+        ssize_t count = read(STDIN_FILENO, bytes, sizeof(bytes));
+        if (count <= 0) {
+            break;
+        }
+        int pushed = 0;
+        for (ssize_t i = 0; i < count; i++) {
+            int key = decode_key_byte(&escape_state, bytes[i]);
+            if (key != ERR) {
+                pushed += key_queue_push(&pipeline->keys, key);
+            }
+        }
+        if (pushed) {
+            pthread_mutex_lock(&pipeline->key_lock);
+            pthread_cond_signal(&pipeline->key_arrived); // Wake the simulation between ticks
+            pthread_mutex_unlock(&pipeline->key_lock);
+        }
+    }
+    return NULL;
+}
+
+// Function to wait until a key press is queued or the deadline passes, returning 1 for a key
+int pipeline_wait_for_key(Pipeline *pipeline, long long deadline_us) {
+    struct timespec deadline = { (time_t)(deadline_us / 1000000), (long)(deadline_us % 1000000) * 1000 };
+    pthread_mutex_lock(&pipeline->key_lock);
+    while (key_queue_empty(&pipeline->keys)) {
+        if (pthread_cond_timedwait(&pipeline->key_arrived, &pipeline->key_lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&pipeline->key_lock);
+    return !key_queue_empty(&pipeline->keys);
+}
+
+// Function to apply every queued key press and publish the resulting state
+void pipeline_apply_keys(Pipeline *pipeline) {
+    GameState *game_state = pipeline->game_state;
+    int key;
+    while (key_queue_pop(&pipeline->keys, &key)) {
+        handle_game_key(game_state, pipeline->config, key);
+    }
+    if (game_state->frog_y == 1) {
+        game_state->score += 5;
+        next_level(game_state, pipeline->config); // Proceed to the next level
+    }
+    triple_buffer_publish(&pipeline->frames, game_state);
+}
+
+// Simulation thread: advance the game at a fixed rate, apply key presses as soon as they
+// arrive between ticks, and publish every completed state
+void* pipeline_simulation_thread(void *arg) {
+    Pipeline *pipeline = arg;
+    trace_thread_name("simulation");
+    GameState *game_state = pipeline->game_state;
+    Config *config = pipeline->config;
+    long long tick_us = 1000000 / PIPELINE_TICKS_PER_SECOND;
+    long long next_tick = pipeline_now_us();
+
+    while (game_state->lives > 0) {
+        check_game_events(game_state, config);
+        pipeline_apply_keys(pipeline);
+
+        next_tick += tick_us;
+        if (next_tick <= pipeline_now_us()) {
+            next_tick = pipeline_now_us(); // Fell behind, skip the missed ticks instead of bursting
+        }
+        while (pipeline_wait_for_key(pipeline, next_tick)) {
+            pipeline_apply_keys(pipeline); // Holding keys for the next tick would add up to a tick of lag
+        }
+    }
+    atomic_store(&pipeline->running, 0);
+    return NULL;
+}
+
+// Render thread: the only thread that calls ncurses, drawing the newest completed state
+void* pipeline_render_thread(void *arg) {
+    Pipeline *pipeline = arg;
+    trace_thread_name("render");
+
+    while (atomic_load(&pipeline->running)) {
+        int fresh;
+        GameState *game_state = triple_buffer_latest(&pipeline->frames, &fresh);
+        if (fresh) {
+            clear();
+            draw_game_elements(game_state, pipeline->config);
+            refresh(); // A slow terminal only delays this thread
+        } else {
+            usleep(1000);
+        }
+    }
+    return NULL;
+}
+
+// Function to run the game with input, simulation and drawing on separate threads.
+// The screen size is fixed for the whole game, since the simulation reads it while drawing happens.
+void run_pipelined_game(GameState *game_state, Config *config) {
+    static Pipeline pipeline; // Holds three game states, too big for the stack on large boards
+    pthread_t input, simulation, render;
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.config = config;
+    pipeline.game_state = game_state;
+    atomic_store(&pipeline.keys.head, 0);
+    atomic_store(&pipeline.keys.tail, 0);
+    atomic_store(&pipeline.running, 1);
+    pthread_condattr_t key_arrived_attr;
+    pthread_condattr_init(&key_arrived_attr);
+    pthread_condattr_setclock(&key_arrived_attr, CLOCK_MONOTONIC); // Deadlines come from pipeline_now_us
+    pthread_mutex_init(&pipeline.key_lock, NULL);
+    pthread_cond_init(&pipeline.key_arrived, &key_arrived_attr);
+    pthread_condattr_destroy(&key_arrived_attr);
+
+    start_level(game_state, config);
+    triple_buffer_init(&pipeline.frames, game_state);
+
+    pthread_create(&input, NULL, pipeline_input_thread, &pipeline);
+    pthread_create(&render, NULL, pipeline_render_thread, &pipeline);
+    pthread_create(&simulation, NULL, pipeline_simulation_thread, &pipeline);
+    pthread_join(simulation, NULL);
+    pthread_join(render, NULL);
+    pthread_join(input, NULL);
+    pthread_cond_destroy(&pipeline.key_arrived);
+    pthread_mutex_destroy(&pipeline.key_lock);
+}
@@ -0,0 +1,36 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdatomic.h>
+#include "config.h"
+#include "game.h"
+
+#define PIPELINE_TICKS_PER_SECOND 10 // Matches the pace of the serial loop waiting on getch
+#define KEY_QUEUE_SIZE 64            // Must be a power of two
+
+// KeyQueue is a single-producer single-consumer ring of key presses
+typedef struct KeyQueue {
+    int keys[KEY_QUEUE_SIZE];
+    atomic_uint head; // Next slot to read, owned by the consumer
+    atomic_uint tail; // Next slot to write, owned by the producer
+} KeyQueue;
+
+// TripleBuffer hands complete game states from the simulation to the renderer
+// without either side ever waiting for the other
+typedef struct TripleBuffer {
+    GameState slots[3];
+    atomic_int middle; // Slot most recently published, with TRIPLE_BUFFER_FRESH if unread
+    int back;          // Slot the simulation writes next
+    int front;         // Slot the renderer is drawing
+} TripleBuffer;
+
+// Function declarations
+int key_queue_push(KeyQueue *queue, int key);
+int key_queue_pop(KeyQueue *queue, int *key);
+int key_queue_empty(KeyQueue *queue);
+void triple_buffer_init(TripleBuffer *buffer, const GameState *game_state);
+void triple_buffer_publish(TripleBuffer *buffer, const GameState *game_state);
+GameState* triple_buffer_latest(TripleBuffer *buffer, int *fresh);
+void run_pipelined_game(GameState *game_state, Config *config);
+
+#endif
@@ -0,0 +1,62 @@
+#include "pregen.h"
+#include "trace.h"
+
+// Worker thread: generate the level with the same code as a synchronous restart
+void* level_pregen_thread(void *arg) {
+    LevelPregen *pregen = arg;
+    trace_thread_name("level pregen");
+    restart_game(&pregen->next, &pregen->config);
+    return NULL;
+}
+
+// Function to wait for the worker, if one is running
+void level_pregen_stop(LevelPregen *pregen) {
+    if (pregen->running) {
+        pthread_join(pregen->thread, NULL);
+        pregen->running = 0;
+    }
+}
+
+// Function to start generating the level after the one just started.
+// Generation only draws from the game's generator, which does not advance during play,
+// so the result is the same as calling restart_game at the transition.
+void level_pregen_start(LevelPregen *pregen, const GameState *game_state, const Config *config) {
+    level_pregen_stop(pregen);
+    pregen->ready = 0;
+
+    pregen->next = *game_state;
+    pregen->next.level++;
+    pregen->config = *config; // Snapshot, since the game loop updates the screen size
+    pregen->source_rng = game_state->rng_state;
+    if (pthread_create(&pregen->thread, NULL, level_pregen_thread, pregen) == 0) {
+        pregen->running = 1;
+        pregen->ready = 1;
+    }
+}
+
+// Function to swap the pre-generated level into the game, returning 0 if it does not
+// match the game any more (a saved game was loaded or the screen was resized)
+int level_pregen_take(LevelPregen *pregen, GameState *game_state, const Config *config) {
+    level_pregen_stop(pregen); // Normally finished long ago
+    if (!pregen->ready || pregen->next.level != game_state->level || pregen->source_rng != game_state->rng_state ||
+        pregen->config.screen_width != config->screen_width || pregen->config.screen_height != config->screen_height ||
+        pregen->config.level_pack != config->level_pack) {
+        pregen->ready = 0;
+        return 0;
+    }
+    pregen->ready = 0;
+
+    // Keep everything restart_game leaves alone, since it changed during the level.
+    // The tick restarts with every level, so the level's scheduled events still line up.
+    int score = game_state->score, lives = game_state->lives;
+    time_t start_time = game_state->start_time, last_jump_time = game_state->last_jump_time;
+    int frog_carried = game_state->frog_carried, carrying_car_index = game_state->carrying_car_index;
+    *game_state = pregen->next;
+    game_state->score = score;
+    game_state->lives = lives;
+    game_state->start_time = start_time;
+    game_state->last_jump_time = last_jump_time;
+    game_state->frog_carried = frog_carried;
+    game_state->carrying_car_index = carrying_car_index;
+    return 1;
+}
@@ -0,0 +1,24 @@
+#ifndef PREGEN_H
+#define PREGEN_H
+
+#include <pthread.h>
+#include "config.h"
+#include "game.h"
+
+// LevelPregen builds the next level's layout on a worker thread while the current
+// level is played, so the level transition only has to copy it in
+typedef struct LevelPregen {
+    pthread_t thread;
+    int running;             // A worker was started and has not been joined yet
+    int ready;               // next holds a finished layout
+    GameState next;          // The level being generated, owned by the worker until joined
+    Config config;           // Settings the layout is generated for
+    unsigned int source_rng; // Generator state of the level it follows
+} LevelPregen;
+
+// Function declarations
+void level_pregen_start(LevelPregen *pregen, const GameState *game_state, const Config *config);
+int level_pregen_take(LevelPregen *pregen, GameState *game_state, const Config *config);
+void level_pregen_stop(LevelPregen *pregen);
+
+#endif
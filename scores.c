@@ -0,0 +1,321 @@
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "scores.h"
+
+#define SCORE_INDEX_MAGIC "FROGIDX1"
+#define SCORE_SCAN_CHUNK 256 // Records read at once when scanning the log
+
+// Function to checksum the fields of a record that precede the checksum itself
+uint32_t score_checksum(const ScoreRecord *record) {
+    const unsigned char *bytes = (const unsigned char *)record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(ScoreRecord, checksum); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Function to check that a record was written completely
+int score_record_valid(const ScoreRecord *record) {
+    return record->magic == SCORE_RECORD_MAGIC && record->checksum == score_checksum(record);
+}
+
+// Function to fill in a record for a game finishing now
+void score_record_init(ScoreRecord *record, int score, int level, int seconds_played) {
+    memset(record, 0, sizeof(*record));
+    record->magic = SCORE_RECORD_MAGIC;
+    record->score = score;
+    record->level = level;
+    record->finished_at = (int64_t)time(NULL);
+    record->day = (int32_t)(record->finished_at / 86400);
+    record->seconds_played = seconds_played;
+    record->checksum = score_checksum(record);
+}
+
+// Function to get the key a record is filed under on a leaderboard
+int32_t score_key(const ScoreRecord *record, int board) {
+    if (board == SCORES_BY_LEVEL) return record->level;
+    if (board == SCORES_BY_DAY) return record->day;
+    return 0;
+}
+
+// Function to order index entries by key, then by score from highest, then by age
+int score_entry_compare(const void *a, const void *b) {
+    const ScoreIndexEntry *x = a, *y = b;
+    if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+    if (x->score != y->score) return (x->score > y->score) ? -1 : 1;
+    return (x->record < y->record) ? -1 : (x->record > y->record);
+}
+
+// Function to read the index header, returning 0 if there is no usable index
+int score_read_index_header(int index_fd, ScoreIndexHeader *header) {
+    if (index_fd < 0 || pread(index_fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)) {
+        return 0;
+    }
+    return memcmp(header->magic, SCORE_INDEX_MAGIC, sizeof(header->magic)) == 0;
+}
+
+// Function to get how many log records the index covers
+uint32_t score_indexed_records(const char *index_file) {
+    ScoreIndexHeader header;
+    int fd = open(index_file, O_RDONLY);
+    uint32_t indexed = score_read_index_header(fd, &header) ? header.indexed_records : 0;
+    if (fd >= 0) close(fd);
+    return indexed;
+}
+
+// Function to check that an index file is complete and covers no more than the log holds
+int score_index_usable(int index_fd, const ScoreIndexHeader *header, uint32_t records) {
+    struct stat info;
+    off_t expected = (off_t)sizeof(ScoreIndexHeader) + (off_t)SCORE_BOARDS * header->entries * (off_t)sizeof(ScoreIndexEntry);
+    return header->indexed_records <= records && header->entries <= header->indexed_records &&
+           fstat(index_fd, &info) == 0 && info.st_size == expected;
+}
+
+// Function to read the valid log records from first_record on and turn them into index entries,
+// one run per leaderboard, returning how many records were valid or -1 on error
+int score_tail_entries(int log_fd, uint32_t first_record, uint32_t records, ScoreIndexEntry *entries) {
+    uint32_t count = records - first_record;
+    ScoreRecord *log = malloc((size_t)count * sizeof(ScoreRecord) + 1);
+    if (log == NULL || pread(log_fd, log, (size_t)count * sizeof(ScoreRecord), (off_t)first_record * (off_t)sizeof(ScoreRecord)) !=
+                       (ssize_t)((size_t)count * sizeof(ScoreRecord))) {
+        free(log);
+        return -1;
+    }
+    uint32_t valid = 0;
+    for (uint32_t r = 0; r < count; r++) {
+        if (!score_record_valid(&log[r])) {
+            continue; // Skip records damaged by a crash
+        }
+        for (int b = 0; b < SCORE_BOARDS; b++) {
+            entries[(size_t)b * count + valid] = (ScoreIndexEntry){ score_key(&log[r], b), log[r].score, first_record + r };
+        }
+        valid++;
+    }
+    free(log);
+    return (int)valid;
+}
+
+// Function to merge one sorted leaderboard section of the old index with the sorted new entries
+int score_merge_section(int index_fd, off_t section, uint32_t old_entries,
+                        const ScoreIndexEntry *added, uint32_t added_entries, FILE *file) {
+    ScoreIndexEntry chunk[SCORE_SCAN_CHUNK];
+    uint32_t read = 0, in_chunk = 0, next = 0, a = 0;
+    while (next < in_chunk || read < old_entries || a < added_entries) {
+        if (next == in_chunk && read < old_entries) { // Refill from the old section
+            in_chunk = (old_entries - read < SCORE_SCAN_CHUNK) ? old_entries - read : SCORE_SCAN_CHUNK;
+            ssize_t bytes = (ssize_t)(in_chunk * sizeof(ScoreIndexEntry));
+            if (pread(index_fd, chunk, (size_t)bytes, section + (off_t)read * (off_t)sizeof(ScoreIndexEntry)) != bytes) {
+                return -1;
+            }
+            read += in_chunk;
+            next = 0;
+        }
+        const ScoreIndexEntry *entry;
+        if (next < in_chunk && (a == added_entries || score_entry_compare(&chunk[next], &added[a]) <= 0)) {
+            entry = &chunk[next++];
+        } else {
+            entry = &added[a++];
+        }
+        if (fwrite(entry, sizeof(*entry), 1, file) != 1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to bring the index file up to date with the log, replacing it atomically. Only the
+// records appended since the last update are sorted; they are then merged into the existing
+// sorted sections. Called with the log locked, so only one process updates at a time.
+int score_store_rebuild_index(int log_fd, const char *index_file) {
+    struct stat info;
+    if (fstat(log_fd, &info) < 0) {
+        return -1;
+    }
+    uint32_t records = (uint32_t)(info.st_size / (off_t)sizeof(ScoreRecord));
+
+    int index_fd = open(index_file, O_RDONLY);
+    ScoreIndexHeader old;
+    if (!score_read_index_header(index_fd, &old) || !score_index_usable(index_fd, &old, records)) {
+        memset(&old, 0, sizeof(old)); // No usable index, index the whole log
+    }
+    uint32_t added_records = records - old.indexed_records;
+    ScoreIndexEntry *added = malloc((size_t)added_records * SCORE_BOARDS * sizeof(ScoreIndexEntry) + 1);
+    int valid = (added != NULL) ? score_tail_entries(log_fd, old.indexed_records, records, added) : -1;
+    int result = -1;
+
+    if (valid >= 0) {
+        ScoreIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SCORE_INDEX_MAGIC, sizeof(header.magic));
+        header.indexed_records = records;
+        header.entries = old.entries + (uint32_t)valid;
+
+        char temp_file[256];
+        snprintf(temp_file, sizeof(temp_file), "%s.tmp", index_file);
+        FILE *file = fopen(temp_file, "wb");
+        if (file != NULL) {
+            int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+            for (int b = 0; b < SCORE_BOARDS; b++) {
+                ScoreIndexEntry *run = added + (size_t)b * added_records;
+                off_t section = (off_t)sizeof(ScoreIndexHeader) + (off_t)b * old.entries * (off_t)sizeof(ScoreIndexEntry);
+                qsort(run, (size_t)valid, sizeof(ScoreIndexEntry), score_entry_compare);
+                ok = ok && score_merge_section(index_fd, section, old.entries, run, (uint32_t)valid, file) == 0;
+            }
+            ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+            ok = (fclose(file) == 0) && ok;
+            result = (ok && rename(temp_file, index_file) == 0) ? 0 : -1;
+            if (result != 0) remove(temp_file);
+        }
+    }
+    if (index_fd >= 0) close(index_fd);
+    free(added);
+    return result;
+}
+
+// Function to append a record to the log, safe against crashes and concurrent writers
+int score_store_append(const char *log_file, const char *index_file, const ScoreRecord *record) {
+    int fd = open(log_file, O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (flock(fd, LOCK_EX) < 0) { // Serialise writers from all game processes
+        close(fd);
+        return -1;
+    }
+
+    int result = -1;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        off_t aligned = info.st_size - info.st_size % (off_t)sizeof(ScoreRecord);
+        // Drop a partial record left by a crash so every record stays aligned
+        if ((aligned == info.st_size || ftruncate(fd, aligned) == 0) &&
+            write(fd, record, sizeof(*record)) == (ssize_t)sizeof(*record) && fdatasync(fd) == 0) {
+            result = 0;
+            uint32_t records = (uint32_t)(aligned / (off_t)sizeof(ScoreRecord)) + 1;
+            if (records - score_indexed_records(index_file) > SCORE_INDEX_SLACK) {
+                score_store_rebuild_index(fd, index_file);
+            }
+        }
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+    return result;
+}
+
+// Function to append a record from a detached process so the game can exit immediately
+void score_store_append_async(const char *log_file, const char *index_file, const ScoreRecord *record) {
+    pid_t child = fork();
+    if (child == 0) {
+        // The grandchild does the work; the child exits at once so nobody waits or leaves a zombie
+        if (fork() == 0) {
+            score_store_append(log_file, index_file, record);
+        }
+        _exit(0);
+    }
+    if (child > 0) {
+        waitpid(child, NULL, 0);
+    } else {
+        score_store_append(log_file, index_file, record); // Could not fork, write it ourselves
+    }
+}
+
+// Function to insert a record into a top-k list kept sorted by score
+void score_top_insert(ScoreRecord *top, int *count, int k, const ScoreRecord *record) {
+    int i = *count;
+    if (i == k) {
+        if (top[k - 1].score >= record->score) return; // Not good enough for the list
+        i = k - 1;
+    } else {
+        (*count)++;
+    }
+    while (i > 0 && top[i - 1].score < record->score) {
+        top[i] = top[i - 1];
+        i--;
+    }
+    top[i] = *record;
+}
+
+// Function to find the first index entry with the given key by binary search
+uint32_t score_index_lower_bound(int index_fd, off_t section, uint32_t entries, int32_t key) {
+    uint32_t low = 0, high = entries;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        ScoreIndexEntry entry;
+        if (pread(index_fd, &entry, sizeof(entry), section + (off_t)mid * (off_t)sizeof(entry)) != (ssize_t)sizeof(entry)) {
+            return entries;
+        }
+        if (entry.key < key) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+// Function to collect the best k indexed records for a key
+void score_top_from_index(int index_fd, int log_fd, const ScoreIndexHeader *header, int board, int32_t key,
+                          ScoreRecord *top, int *count, int k) {
+    off_t section = (off_t)sizeof(ScoreIndexHeader) + (off_t)board * header->entries * (off_t)sizeof(ScoreIndexEntry);
+    uint32_t first = score_index_lower_bound(index_fd, section, header->entries, key);
+
+    for (uint32_t i = first; i < header->entries && i < first + (uint32_t)k; i++) {
+        ScoreIndexEntry entry;
+        ScoreRecord record;
+        if (pread(index_fd, &entry, sizeof(entry), section + (off_t)i * (off_t)sizeof(entry)) != (ssize_t)sizeof(entry) ||
+            entry.key != key) {
+            break; // Past the entries for this key
+        }
+        if (pread(log_fd, &record, sizeof(record), (off_t)entry.record * (off_t)sizeof(record)) == (ssize_t)sizeof(record) &&
+            score_record_valid(&record)) {
+            score_top_insert(top, count, k, &record);
+        }
+    }
+}
+
+// Function to scan the records appended since the index was last rebuilt
+void score_top_from_tail(int log_fd, uint32_t first_record, int board, int32_t key, ScoreRecord *top, int *count, int k) {
+    ScoreRecord chunk[SCORE_SCAN_CHUNK];
+    off_t offset = (off_t)first_record * (off_t)sizeof(ScoreRecord);
+    ssize_t bytes;
+    while ((bytes = pread(log_fd, chunk, sizeof(chunk), offset)) > 0) {
+        int records = (int)((size_t)bytes / sizeof(ScoreRecord));
+        for (int i = 0; i < records; i++) {
+            if (score_record_valid(&chunk[i]) && score_key(&chunk[i], board) == key) {
+                score_top_insert(top, count, k, &chunk[i]);
+            }
+        }
+        if (records == 0) break;
+        offset += (off_t)records * (off_t)sizeof(ScoreRecord);
+    }
+}
+
+// Function to get the k best records for a leaderboard key, returning how many were found
+int score_store_top(const char *log_file, const char *index_file, int board, int key, ScoreRecord *top, int k) {
+    int log_fd = open(log_file, O_RDONLY);
+    if (log_fd < 0 || k <= 0) {
+        if (log_fd >= 0) close(log_fd);
+        return 0;
+    }
+    int index_fd = open(index_file, O_RDONLY);
+    ScoreIndexHeader header;
+    int count = 0;
+    uint32_t indexed = 0;
+
+    if (score_read_index_header(index_fd, &header)) {
+        score_top_from_index(index_fd, log_fd, &header, board, key, top, &count, k);
+        indexed = header.indexed_records;
+    }
+    score_top_from_tail(log_fd, indexed, board, key, top, &count, k);
+
+    if (index_fd >= 0) close(index_fd);
+    close(log_fd);
+    return count;
+}
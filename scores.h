@@ -0,0 +1,51 @@
+#ifndef SCORES_H
+#define SCORES_H
+
+#include <stdint.h>
+
+#define SCORE_LOG_FILE "scores.log"
+#define SCORE_INDEX_FILE "scores.idx"
+#define SCORE_RECORD_MAGIC 0x46524f47u // "FROG"
+#define SCORE_INDEX_SLACK 1024         // Unindexed records allowed before the index is rebuilt
+
+// Leaderboards kept in the index, each sorted by key and then by score
+enum ScoreBoard {
+    SCORES_GLOBAL = 0, // Key is always 0
+    SCORES_BY_LEVEL,   // Key is the level reached
+    SCORES_BY_DAY,     // Key is the day the game finished, in days since the epoch
+    SCORE_BOARDS
+};
+
+// ScoreRecord is one finished game in the append-only score log
+typedef struct ScoreRecord {
+    uint32_t magic;
+    int32_t score;
+    int32_t level;
+    int32_t day;
+    int64_t finished_at;
+    int32_t seconds_played;
+    uint32_t checksum; // Detects records torn by a crash during the write
+} ScoreRecord;
+
+// ScoreIndexEntry points from a leaderboard position to a record in the log
+typedef struct ScoreIndexEntry {
+    int32_t key;
+    int32_t score;
+    uint32_t record;
+} ScoreIndexEntry;
+
+// ScoreIndexHeader starts the index file and is followed by one section per leaderboard
+typedef struct ScoreIndexHeader {
+    char magic[8];
+    uint32_t indexed_records; // Log records covered by the index
+    uint32_t entries;         // Entries in each section
+} ScoreIndexHeader;
+
+// Function declarations
+void score_record_init(ScoreRecord *record, int score, int level, int seconds_played);
+int score_store_append(const char *log_file, const char *index_file, const ScoreRecord *record);
+void score_store_append_async(const char *log_file, const char *index_file, const ScoreRecord *record);
+int score_store_rebuild_index(int log_fd, const char *index_file);
+int score_store_top(const char *log_file, const char *index_file, int board, int key, ScoreRecord *top, int k);
+
+#endif
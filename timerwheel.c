@@ -0,0 +1,100 @@
+#include "timerwheel.h"
+
+// Function to empty the wheel, starting it at the given tick
+void timer_wheel_init(TimerWheel *wheel, int current) {
+    wheel->current = current;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            wheel->head[level][slot] = TIMER_NONE;
+        }
+    }
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        wheel->next[i] = wheel->prev[i] = wheel->slot[i] = TIMER_NONE;
+        wheel->due[i] = TIMER_NONE;
+    }
+}
+
+// Function to get the slot a timer belongs in: the lowest level whose slots still
+// tell its due tick apart from the current one
+int timer_wheel_slot(TimerWheel *wheel, int due) {
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        int shift = level * TIMER_WHEEL_BITS;
+        if ((due >> shift) - (wheel->current >> shift) < TIMER_WHEEL_SLOTS) {
+            return level * TIMER_WHEEL_SLOTS + ((due >> shift) & (TIMER_WHEEL_SLOTS - 1));
+        }
+    }
+    int shift = (TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_BITS;
+    int last = ((wheel->current >> shift) - 1) & (TIMER_WHEEL_SLOTS - 1); // Comes up last; re-filed from there
+    return (TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_SLOTS + last;
+}
+
+// Function to link a timer into the slot for its due tick
+void timer_wheel_link(TimerWheel *wheel, int timer) {
+    int slot = timer_wheel_slot(wheel, wheel->due[timer]);
+    int *head = &wheel->head[slot / TIMER_WHEEL_SLOTS][slot % TIMER_WHEEL_SLOTS];
+    wheel->slot[timer] = slot;
+    wheel->prev[timer] = TIMER_NONE;
+    wheel->next[timer] = *head;
+    if (*head != TIMER_NONE) {
+        wheel->prev[*head] = timer;
+    }
+    *head = timer;
+}
+
+// Function to unlink a timer from its slot
+void timer_wheel_unlink(TimerWheel *wheel, int timer) {
+    if (wheel->prev[timer] != TIMER_NONE) {
+        wheel->next[wheel->prev[timer]] = wheel->next[timer];
+    } else {
+        int slot = wheel->slot[timer];
+        wheel->head[slot / TIMER_WHEEL_SLOTS][slot % TIMER_WHEEL_SLOTS] = wheel->next[timer];
+    }
+    if (wheel->next[timer] != TIMER_NONE) {
+        wheel->prev[wheel->next[timer]] = wheel->prev[timer];
+    }
+    wheel->next[timer] = wheel->prev[timer] = TIMER_NONE;
+}
+
+// Function to cancel a timer if it is scheduled
+void timer_wheel_cancel(TimerWheel *wheel, int timer) {
+    if (wheel->due[timer] != TIMER_NONE) {
+        timer_wheel_unlink(wheel, timer);
+        wheel->due[timer] = TIMER_NONE;
+    }
+}
+
+// Function to schedule a timer, moving it if it was already scheduled.
+// Ticks already reached are treated as the next tick.
+void timer_wheel_schedule(TimerWheel *wheel, int timer, int due) {
+    timer_wheel_cancel(wheel, timer);
+    wheel->due[timer] = (due > wheel->current) ? due : wheel->current + 1;
+    timer_wheel_link(wheel, timer);
+}
+
+// Function to move to the next tick, cascading higher-level slots that come up
+void timer_wheel_advance(TimerWheel *wheel) {
+    wheel->current++;
+    for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+        int shift = level * TIMER_WHEEL_BITS;
+        if ((wheel->current & ((1 << shift) - 1)) == 0) {
+            int *head = &wheel->head[level][(wheel->current >> shift) & (TIMER_WHEEL_SLOTS - 1)];
+            int timer = *head;
+            *head = TIMER_NONE;
+            while (timer != TIMER_NONE) {
+                int next = wheel->next[timer];
+                timer_wheel_link(wheel, timer); // Lands in a lower level now that it is closer
+                timer = next;
+            }
+        }
+    }
+}
+
+// Function to take the next timer due on the current tick, or TIMER_NONE once there are none
+int timer_wheel_pop(TimerWheel *wheel) {
+    int timer = wheel->head[0][wheel->current & (TIMER_WHEEL_SLOTS - 1)];
+    if (timer != TIMER_NONE) {
+        timer_wheel_unlink(wheel, timer);
+        wheel->due[timer] = TIMER_NONE;
+    }
+    return timer;
+}
@@ -0,0 +1,37 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "config.h"
+
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4 // Timers up to 2^24 ticks ahead; later ones are parked in the top level
+#define TIMER_NONE -1
+
+// Timers owned by the game: a speed change and a stop check per car, an expiry per coin
+#define CAR_SPEED_TIMER(i) (i)
+#define CAR_STOP_TIMER(i) (MAX_CARS + (i))
+#define COIN_TIMER(i) (2 * MAX_CARS + (i))
+#define MAX_TIMERS (2 * MAX_CARS + MAX_COINS)
+
+// TimerWheel is a hierarchical timer wheel keyed by tick. Level 0 has a slot per tick
+// for the next 64 ticks, each higher level a slot per 64 slots of the level below, and
+// timers cascade down as their slot comes up. Scheduling, cancelling and advancing a
+// tick with nothing due are all constant time. Timers are linked by index rather than
+// by pointer, so the wheel can be copied along with the rest of the game state.
+typedef struct TimerWheel {
+    int current;                                         // Last tick advanced to
+    int head[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];     // First timer in each slot
+    int next[MAX_TIMERS], prev[MAX_TIMERS];              // Doubly linked slot lists
+    int slot[MAX_TIMERS];                                // Slot each timer is linked into, as level * TIMER_WHEEL_SLOTS + slot
+    int due[MAX_TIMERS];                                 // Tick each timer fires on, TIMER_NONE if idle
+} TimerWheel;
+
+// Function declarations
+void timer_wheel_init(TimerWheel *wheel, int current);
+void timer_wheel_schedule(TimerWheel *wheel, int timer, int due);
+void timer_wheel_cancel(TimerWheel *wheel, int timer);
+void timer_wheel_advance(TimerWheel *wheel);
+int timer_wheel_pop(TimerWheel *wheel);
+
+#endif
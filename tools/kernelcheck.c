@@ -0,0 +1,300 @@
+// Car kernel consistency check. Plays the same seeded game once per car kernel and lane
+// thread count and compares the packed state hash after every tick. The kernel is picked
+// once per process, so every run happens in its own child process with FROG_CAR_KERNEL set.
+//
+// Build: gcc -Wall -O2 -pthread -I. -o kernelcheck tools/kernelcheck.c $(ls *.c | grep -v -e main.c -e pipeline.c) -lncurses -lm
+// Run:   ./kernelcheck [-n ticks] [-s seed] [-t]
+//
+// -t times the ticks instead, with the widest kernel at 1, 2, 4 and one per CPU lane threads,
+// and also times one lane pool hand-off and barrier with an empty job.
+//
+// Add -DMAX_CARS=... -DMAX_FRIENDLY_CARS=... to the build to check a large board; the lane
+// pool only splits boards of at least 2 * LANE_POOL_MIN_CARS cars, so use -DMAX_CARS=65536
+// to exercise the threads. A kernel the CPU lacks falls back to the next narrower one; the
+// report shows which one ran.
+// Exits with 1 if any run differs from the first.
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "carkernel.h"
+#include "config.h"
+#include "game.h"
+#include "lanepool.h"
+#include "packed_state.h"
+
+#define KERNEL_NAME_SIZE 16
+
+// Kernel limits and lane thread counts to run; the first run is the reference
+static const char *kernels[] = { "scalar", "sse4.1", "avx2" };
+static const int lane_threads[] = { 1, 2, 4 };
+#define KERNEL_COUNT (int)(sizeof(kernels) / sizeof(kernels[0]))
+#define THREAD_COUNTS (int)(sizeof(lane_threads) / sizeof(lane_threads[0]))
+
+// Function to set up a configuration that fills the board with as many cars as the build holds
+void check_config(Config *config, int threads) {
+    memset(config, 0, sizeof(*config));
+    config->lane_threads = threads;
+    config->screen_width = 80;
+    config->screen_height = 24;
+    config->max_cars = MAX_CARS;
+    config->max_friendly_cars = MAX_FRIENDLY_CARS;
+    config->max_coins = MAX_COINS;
+    config->max_storks = MAX_STORKS;
+    config->proximity_threshold = 3;
+    config->max_speed_level_1 = 1;
+    config->max_speed_level_2 = 2;
+    config->max_speed_level_3 = 3;
+}
+
+// Function to walk the frog in a fixed pattern so stopping cars and carrying come into play
+void check_move_frog(GameState *game_state, Config *config, int tick) {
+    static const int dx[4] = { 1, 0, -1, 0 };
+    static const int dy[4] = { 0, -1, 0, 1 };
+    int step = (tick / 7) % 4;
+    int x = game_state->frog_x + dx[step], y = game_state->frog_y + dy[step];
+    if (x >= 0 && x < config->screen_width && y >= 2 && y < config->screen_height - 1) {
+        game_state->frog_x = x;
+        game_state->frog_y = y;
+    }
+}
+
+// Function to play the seeded game for the given number of ticks, writing the hash of every tick
+int check_run(int fd, int ticks, unsigned int seed, int threads) {
+    static GameState game_state;
+    static PackedState packed;
+    Config config;
+    check_config(&config, threads);
+
+    char name[KERNEL_NAME_SIZE] = "";
+    snprintf(name, sizeof(name), "%s", car_kernel_name());
+    if (write(fd, name, sizeof(name)) != (ssize_t)sizeof(name)) {
+        return 1;
+    }
+    for (int tick = 0; tick < ticks; tick++) {
+        if (tick % (ticks / 3 + 1) == 0) { // Play through all three built-in levels
+            memset(&game_state, 0, sizeof(game_state));
+            game_state.level = tick / (ticks / 3 + 1) + 1;
+            game_state.lives = 3;
+            game_state.rng_state = seed + (unsigned int)game_state.level;
+            restart_game(&game_state, &config);
+        }
+        update_game(&game_state, &config);
+        check_move_frog(&game_state, &config, tick);
+        pack_state(&game_state, &packed);
+        uint64_t hash = packed_state_hash(&packed);
+        if (write(fd, &hash, sizeof(hash)) != (ssize_t)sizeof(hash)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to read the monotonic clock in nanoseconds
+double check_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+// Lane job that does nothing, to time the pool's hand-off and barrier on their own
+void check_empty_job(GameState *game_state, Config *config, int begin, int end) {
+    (void)game_state;
+    (void)config;
+    (void)begin;
+    (void)end;
+}
+
+// Function to time the seeded game on level 3, writing the mean nanoseconds per tick and per
+// empty pool job; the job is timed only when more than one thread shares the board
+int check_time_run(int fd, int ticks, unsigned int seed, int threads) {
+    static GameState game_state;
+    static LanePool pool;
+    Config config;
+    check_config(&config, threads);
+
+    game_state.level = 3;
+    game_state.lives = 3;
+    game_state.rng_state = seed;
+    restart_game(&game_state, &config);
+    update_game(&game_state, &config); // Starts the pool threads outside the timed ticks
+    double start = check_now_ns();
+    for (int tick = 0; tick < ticks; tick++) {
+        update_game(&game_state, &config);
+        check_move_frog(&game_state, &config, tick);
+    }
+    double times[2] = { (check_now_ns() - start) / ticks, 0 };
+
+    if (threads > 1) {
+        lane_pool_start(&pool, threads);
+        start = check_now_ns();
+        for (int i = 0; i < ticks; i++) {
+            lane_pool_run(&pool, check_empty_job, &game_state, &config, pool.threads * LANE_POOL_MIN_CARS);
+        }
+        times[1] = (check_now_ns() - start) / ticks;
+        lane_pool_stop(&pool);
+    }
+    stop_lane_pool();
+    return write(fd, times, sizeof(times)) == (ssize_t)sizeof(times) ? 0 : 1;
+}
+
+// Function to read exactly size bytes from a pipe, returning 0 on a short read
+int check_read(int fd, void *buffer, size_t size) {
+    char *bytes = buffer;
+    while (size > 0) {
+        ssize_t count = read(fd, bytes, size);
+        if (count <= 0) {
+            return 0;
+        }
+        bytes += count;
+        size -= (size_t)count;
+    }
+    return 1;
+}
+
+// Function to time the game at one lane thread count in a child process, so each count gets its own pool
+int check_time(int threads, int ticks, unsigned int seed, double times[2]) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (child == 0) {
+        close(fds[0]);
+        _exit(check_time_run(fds[1], ticks, seed, threads));
+    }
+    close(fds[1]);
+    int ok = check_read(fds[0], times, 2 * sizeof(double));
+    close(fds[0]);
+    int status;
+    waitpid(child, &status, 0);
+    return (ok && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+// Function to report the time per tick at 1, 2, 4 and one per CPU lane threads
+int check_timing(int ticks, unsigned int seed) {
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int counts[] = { 1, 2, 4, cpus };
+    double serial = 0;
+
+    printf("%d cars, %d ticks on level 3, %s kernel, %d CPUs online%s\n", MAX_CARS, ticks, car_kernel_name(), cpus,
+           (MAX_CARS < 2 * LANE_POOL_MIN_CARS) ? ", board too small to split across threads" : "");
+    printf("threads  us/tick  speedup  us/empty job  ns/car\n");
+    for (int i = 0; i < 4; i++) {
+        if (i == 3 && (cpus <= 1 || cpus == 2 || cpus == 4)) {
+            break; // One per CPU is already in the list
+        }
+        double times[2];
+        if (check_time(counts[i], ticks, seed, times) < 0) {
+            printf("%7d  run failed\n", counts[i]);
+            return 1;
+        }
+        if (i == 0) {
+            serial = times[0];
+        }
+        printf("%7d  %7.1f  %6.2fx  %12.2f  %6.2f\n", counts[i], times[0] / 1000, serial / times[0], times[1] / 1000, times[0] / MAX_CARS);
+    }
+    return 0;
+}
+
+// Function to run the game under one kernel limit and thread count in a child process and collect its hashes
+int check_kernel(const char *kernel, int threads, int ticks, unsigned int seed, char *ran, uint64_t *hashes) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    pid_t child = fork();
+    if (child < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (child == 0) {
+        close(fds[0]);
+        setenv("FROG_CAR_KERNEL", kernel, 1);
+        _exit(check_run(fds[1], ticks, seed, threads));
+    }
+    close(fds[1]);
+    int ok = check_read(fds[0], ran, KERNEL_NAME_SIZE) && check_read(fds[0], hashes, (size_t)ticks * sizeof(uint64_t));
+    close(fds[0]);
+    int status;
+    waitpid(child, &status, 0);
+    return (ok && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+// Function to print how to run the check
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n ticks] [-s seed] [-t]\n", program);
+}
+
+// Function to compare every kernel and thread count against the first run
+int main(int argc, char *argv[]) {
+    int ticks = 3000;
+    unsigned int seed = 12345;
+    int timing = 0, opt;
+
+    while ((opt = getopt(argc, argv, "n:s:t")) != -1) {
+        switch (opt) {
+        case 'n': ticks = atoi(optarg); break;
+        case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 't': timing = 1; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (ticks <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (timing) {
+        return check_timing(ticks, seed);
+    }
+
+    uint64_t *reference = malloc((size_t)ticks * sizeof(uint64_t));
+    uint64_t *hashes = malloc((size_t)ticks * sizeof(uint64_t));
+    if (reference == NULL || hashes == NULL) {
+        return 1;
+    }
+    printf("%d cars, %d friendly cars, %d ticks, seed %u%s\n", MAX_CARS, MAX_FRIENDLY_CARS, ticks, seed,
+           (MAX_CARS < 2 * LANE_POOL_MIN_CARS) ? ", board too small to split across threads" : "");
+
+    int failures = 0;
+    for (int run = 0; run < KERNEL_COUNT * THREAD_COUNTS; run++) {
+        const char *kernel = kernels[run / THREAD_COUNTS];
+        int threads = lane_threads[run % THREAD_COUNTS];
+        char ran[KERNEL_NAME_SIZE];
+        if (check_kernel(kernel, threads, ticks, seed, ran, (run == 0) ? reference : hashes) < 0) {
+            printf("%-8s %d thread(s)  run failed\n", kernel, threads);
+            failures++;
+            if (run == 0) {
+                break; // Nothing to compare against
+            }
+            continue;
+        }
+        if (run == 0) {
+            printf("%-8s %d thread(s)  ran %-8s final hash %016llx (reference)\n", kernel, threads, ran, (unsigned long long)reference[ticks - 1]);
+            continue;
+        }
+        int tick = 0;
+        while (tick < ticks && hashes[tick] == reference[tick]) {
+            tick++;
+        }
+        if (tick == ticks) {
+            printf("%-8s %d thread(s)  ran %-8s final hash %016llx identical\n", kernel, threads, ran, (unsigned long long)hashes[ticks - 1]);
+        } else {
+            printf("%-8s %d thread(s)  ran %-8s DIFFERS from tick %d\n", kernel, threads, ran, tick + 1);
+            failures++;
+        }
+    }
+    free(reference);
+    free(hashes);
+    return (failures == 0) ? 0 : 1;
+}
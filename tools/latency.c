@@ -0,0 +1,374 @@
+// Input-to-screen latency harness. Runs the game on a pseudo-terminal, presses arrow keys
+// at fixed times and parses what the game writes to the terminal, measuring how long it
+// takes until the frog is drawn at its new position.
+//
+// Build: gcc -Wall -O2 -o latency tools/latency.c -lutil
+// Run:   ./latency [-n samples] [-i interval_ms] [-t timeout_ms] [-c cols] [-r rows]
+//                  [-f frog_shape] [-k keys] -- ./frog --skip-screens [--pipelined]
+//
+// Keys are a cycle of U, D, L and R; the default "RL" walks the frog along the start row
+// of level 1, which no car or stork can reach, so the game runs unattended indefinitely.
+// The interval must stay above the game's one second jump cooldown.
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_CSI_PARAMS 16
+
+// Parser states for the terminal output stream
+enum ParserState {
+    PARSE_TEXT,
+    PARSE_ESCAPE,
+    PARSE_ESCAPE_ARGUMENT, // ESC followed by an intermediate byte, e.g. ESC ( B
+    PARSE_CSI
+};
+
+// Harness tracks the game's cursor, the frog and the key press waiting to be seen
+typedef struct Harness {
+    int state;
+    int params[MAX_CSI_PARAMS];
+    int param_count;
+    int row, col; // Cursor position, 0-based
+    int rows, cols;
+    char frog_shape;
+
+    int frog_row, frog_col; // Where the frog was last drawn, -1 before the first frame
+    int pending;            // A key press has not been seen on screen yet
+    int expected_row, expected_col;
+    long long sent_us;
+
+    long long *latencies_us;
+    int latency_count;
+    int dropped;
+
+    long long *frame_bytes;
+    long frame_count, frame_capacity;
+    long long bytes_since_frame;
+    int seen_first_frame;
+} Harness;
+
+// Function to read the monotonic clock in microseconds
+long long now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+// Function to get CSI parameter i, or a default if it was left out
+int csi_param(Harness *harness, int i, int fallback) {
+    return (i < harness->param_count && harness->params[i] > 0) ? harness->params[i] : fallback;
+}
+
+// Function to keep the cursor on the screen
+void clamp_cursor(Harness *harness) {
+    if (harness->row < 0) harness->row = 0;
+    if (harness->row >= harness->rows) harness->row = harness->rows - 1;
+    if (harness->col < 0) harness->col = 0;
+    if (harness->col >= harness->cols) harness->col = harness->cols - 1;
+}
+
+// Function to count a frame when the game clears the screen to draw the next one
+void end_frame(Harness *harness) {
+    if (harness->seen_first_frame) {
+        if (harness->frame_count == harness->frame_capacity) {
+            long capacity = harness->frame_capacity ? harness->frame_capacity * 2 : 1024;
+            long long *frames = realloc(harness->frame_bytes, (size_t)capacity * sizeof(long long));
+            if (frames == NULL) {
+                return;
+            }
+            harness->frame_bytes = frames;
+            harness->frame_capacity = capacity;
+        }
+        harness->frame_bytes[harness->frame_count++] = harness->bytes_since_frame;
+    }
+    harness->seen_first_frame = 1;
+    harness->bytes_since_frame = 0;
+}
+
+// Function to apply a complete CSI sequence to the cursor
+void apply_csi(Harness *harness, unsigned char final) {
+    switch (final) {
+    case 'H': case 'f': // Cursor position
+        harness->row = csi_param(harness, 0, 1) - 1;
+        harness->col = csi_param(harness, 1, 1) - 1;
+        break;
+    case 'A': harness->row -= csi_param(harness, 0, 1); break;
+    case 'B': harness->row += csi_param(harness, 0, 1); break;
+    case 'C': harness->col += csi_param(harness, 0, 1); break;
+    case 'D': harness->col -= csi_param(harness, 0, 1); break;
+    case 'G': case '`': harness->col = csi_param(harness, 0, 1) - 1; break;
+    case 'd': harness->row = csi_param(harness, 0, 1) - 1; break;
+    case 'J':
+        if (harness->param_count > 0 && harness->params[0] == 2) {
+            end_frame(harness);
+        }
+        break;
+    default:
+        break; // Colours, erasing and modes do not move the cursor
+    }
+    clamp_cursor(harness);
+}
+
+// Function to handle a printed character, noting where the frog is drawn
+void print_char(Harness *harness, unsigned char ch, long long time_us) {
+    if (ch == (unsigned char)harness->frog_shape) {
+        harness->frog_row = harness->row;
+        harness->frog_col = harness->col;
+        if (harness->pending && harness->row == harness->expected_row && harness->col == harness->expected_col) {
+            harness->latencies_us[harness->latency_count++] = time_us - harness->sent_us;
+            harness->pending = 0;
+        }
+    }
+    if (harness->col < harness->cols - 1) {
+        harness->col++;
+    }
+}
+
+// Function to feed bytes written by the game through the terminal parser
+void feed(Harness *harness, const unsigned char *bytes, ssize_t count, long long time_us) {
+    for (ssize_t i = 0; i < count; i++) {
+        unsigned char ch = bytes[i];
+        harness->bytes_since_frame++;
+
+        switch (harness->state) {
+        case PARSE_TEXT:
+            if (ch == 27) {
+                harness->state = PARSE_ESCAPE;
+            } else if (ch == '\r') {
+                harness->col = 0;
+            } else if (ch == '\n') {
+                harness->row = (harness->row < harness->rows - 1) ? harness->row + 1 : harness->row;
+            } else if (ch == '\b') {
+                harness->col = (harness->col > 0) ? harness->col - 1 : 0;
+            } else if (ch == '\t') {
+                harness->col = (harness->col / 8 + 1) * 8;
+                clamp_cursor(harness);
+            } else if (ch >= 32 && ch < 127) {
+                print_char(harness, ch, time_us);
+            }
+            break;
+        case PARSE_ESCAPE:
+            if (ch == '[') {
+                harness->state = PARSE_CSI;
+                harness->param_count = 0;
+                memset(harness->params, 0, sizeof(harness->params));
+            } else if (ch >= 0x20 && ch <= 0x2f) {
+                harness->state = PARSE_ESCAPE_ARGUMENT;
+            } else {
+                harness->state = PARSE_TEXT; // Two-byte sequences such as ESC = or ESC 7
+            }
+            break;
+        case PARSE_ESCAPE_ARGUMENT:
+            harness->state = PARSE_TEXT;
+            break;
+        case PARSE_CSI:
+            if (ch >= '0' && ch <= '9') {
+                if (harness->param_count == 0) harness->param_count = 1;
+                int *param = &harness->params[harness->param_count - 1];
+                *param = *param * 10 + (ch - '0');
+            } else if (ch == ';') {
+                if (harness->param_count == 0) harness->param_count = 1;
+                if (harness->param_count < MAX_CSI_PARAMS) harness->param_count++;
+            } else if (ch >= 0x40 && ch <= 0x7e) {
+                apply_csi(harness, ch);
+                harness->state = PARSE_TEXT;
+            } // Private markers such as '?' are ignored
+            break;
+        }
+    }
+}
+
+// Function to get the escape sequence and frog movement for a key letter
+const char* key_sequence(char key, int *dx, int *dy) {
+    *dx = 0;
+    *dy = 0;
+    switch (key) {
+    case 'U': *dy = -1; return "\033OA";
+    case 'D': *dy = 1; return "\033OB";
+    case 'R': *dx = 1; return "\033OC";
+    case 'L': *dx = -1; return "\033OD";
+    default: return NULL;
+    }
+}
+
+// Function to order latencies for percentiles
+int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to get a percentile from sorted values
+long long percentile(const long long *sorted, long count, double p) {
+    long index = (long)(p * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Function to print the latency distribution and frame sizes
+void report(Harness *harness) {
+    static const long long bucket_ms[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500 };
+    int buckets = (int)(sizeof(bucket_ms) / sizeof(bucket_ms[0]));
+    long long *latencies = harness->latencies_us;
+    int count = harness->latency_count;
+
+    printf("samples: %d measured, %d dropped (frog not drawn at the expected cell in time)\n", count, harness->dropped);
+    if (count > 0) {
+        long long total = 0;
+        qsort(latencies, (size_t)count, sizeof(long long), compare_long_long);
+        for (int i = 0; i < count; i++) total += latencies[i];
+        printf("latency ms: min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f  mean %.2f\n",
+               latencies[0] / 1000.0, percentile(latencies, count, 0.50) / 1000.0, percentile(latencies, count, 0.90) / 1000.0,
+               percentile(latencies, count, 0.99) / 1000.0, latencies[count - 1] / 1000.0, (double)total / count / 1000.0);
+
+        int i = 0;
+        for (int b = 0; b <= buckets; b++) {
+            int in_bucket = 0;
+            while (i < count && (b == buckets || latencies[i] < bucket_ms[b] * 1000)) {
+                in_bucket++;
+                i++;
+            }
+            if (b < buckets) printf("  < %4lld ms  %5d  ", bucket_ms[b], in_bucket);
+            else printf("  >= %3lld ms  %5d  ", bucket_ms[buckets - 1], in_bucket);
+            for (int bar = 0; bar < in_bucket * 50 / count; bar++) putchar('#');
+            putchar('\n');
+        }
+    }
+    if (harness->frame_count > 0) {
+        long long total = 0;
+        long frames = harness->frame_count;
+        qsort(harness->frame_bytes, (size_t)frames, sizeof(long long), compare_long_long);
+        for (long i = 0; i < frames; i++) total += harness->frame_bytes[i];
+        printf("frames: %ld  bytes/frame: p50 %lld  mean %.0f  max %lld\n",
+               frames, percentile(harness->frame_bytes, frames, 0.50), (double)total / frames, harness->frame_bytes[frames - 1]);
+    }
+}
+
+// Function to print how to run the harness
+void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [-n samples] [-i interval_ms] [-t timeout_ms] [-c cols] [-r rows] [-f frog_shape] [-k keys]"
+                    " -- game [args...]\n", program);
+}
+
+// Function to run the game on a pty, press keys and report the measured latencies
+int main(int argc, char *argv[]) {
+    int samples = 100, interval_ms = 1200, timeout_ms = 1000, cols = 80, rows = 24;
+    char frog_shape = 'F';
+    const char *keys = "RL";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:t:c:r:f:k:")) != -1) {
+        switch (opt) {
+        case 'n': samples = atoi(optarg); break;
+        case 'i': interval_ms = atoi(optarg); break;
+        case 't': timeout_ms = atoi(optarg); break;
+        case 'c': cols = atoi(optarg); break;
+        case 'r': rows = atoi(optarg); break;
+        case 'f': frog_shape = optarg[0]; break;
+        case 'k': keys = optarg; break;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (optind >= argc || samples <= 0 || cols <= 0 || rows <= 0 || keys[0] == '\0') {
+        usage(argv[0]);
+        return 2;
+    }
+    for (const char *key = keys; *key; key++) {
+        int dx, dy;
+        if (key_sequence(*key, &dx, &dy) == NULL) {
+            fprintf(stderr, "Keys must be U, D, L or R.\n");
+            return 2;
+        }
+    }
+
+    Harness harness;
+    memset(&harness, 0, sizeof(harness));
+    harness.rows = rows;
+    harness.cols = cols;
+    harness.frog_shape = frog_shape;
+    harness.frog_row = harness.frog_col = -1;
+    harness.latencies_us = malloc((size_t)samples * sizeof(long long));
+    if (harness.latencies_us == NULL) {
+        return 1;
+    }
+
+    struct winsize size = { (unsigned short)rows, (unsigned short)cols, 0, 0 };
+    int master;
+    pid_t child = forkpty(&master, NULL, NULL, &size);
+    if (child < 0) {
+        perror("forkpty");
+        return 1;
+    }
+    if (child == 0) {
+        setenv("TERM", "xterm", 1); // The parser understands xterm's sequences
+        execvp(argv[optind], &argv[optind]);
+        perror("exec");
+        _exit(127);
+    }
+
+    int sent = 0, game_exited = 0;
+    long long next_send = 0; // Set once the first frame has been drawn
+    while (sent < samples || harness.pending) {
+        long long now = now_us();
+        if (harness.pending && now - harness.sent_us >= (long long)timeout_ms * 1000) {
+            harness.pending = 0;
+            harness.dropped++;
+        }
+        if (next_send == 0 && harness.frog_row >= 0) {
+            next_send = now + 500000; // Let the first level settle
+        }
+        if (next_send != 0 && now >= next_send && sent < samples && !harness.pending) {
+            int dx, dy;
+            const char *sequence = key_sequence(keys[sent % (int)strlen(keys)], &dx, &dy);
+            harness.expected_row = harness.frog_row + dy;
+            harness.expected_col = harness.frog_col + dx;
+            harness.pending = 1;
+            harness.sent_us = now_us();
+            if (write(master, sequence, strlen(sequence)) < 0) {
+                break;
+            }
+            sent++;
+            next_send += (long long)interval_ms * 1000; // Fixed schedule, not drifting with the game's speed
+        }
+
+        long long wake = now + 100000;
+        if (next_send != 0 && sent < samples && next_send < wake) wake = next_send;
+        if (harness.pending && harness.sent_us + (long long)timeout_ms * 1000 < wake) wake = harness.sent_us + (long long)timeout_ms * 1000;
+        int wait_ms = (int)((wake - now + 999) / 1000);
+
+        struct pollfd output = { master, POLLIN, 0 };
+        int ready = poll(&output, 1, wait_ms > 0 ? wait_ms : 0);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready > 0) {
+            unsigned char bytes[65536];
+            ssize_t count = read(master, bytes, sizeof(bytes));
+            if (count <= 0) {
+                game_exited = 1; // EIO once the game has closed the terminal
+                break;
+            }
+            feed(&harness, bytes, count, now_us());
+        }
+    }
+
+    if (!game_exited) {
+        kill(child, SIGTERM);
+    }
+    waitpid(child, NULL, 0);
+    close(master);
+
+    if (game_exited) {
+        printf("The game exited after %d of %d key presses.\n", sent, samples);
+    }
+    report(&harness);
+    free(harness.latencies_us);
+    free(harness.frame_bytes);
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "trace.h"
+
+// TraceEvent is the start or end of one span
+typedef struct TraceEvent {
+    const char *name; // String literal or __func__, so it never needs copying or escaping
+    long long time_ns;
+    char phase;       // 'B' to begin a span, 'E' to end it
+} TraceEvent;
+
+// TraceBuffer holds the events of one thread, appended to without locking
+typedef struct TraceBuffer {
+    TraceEvent *events;
+    size_t count, capacity;
+    int tid;
+    const char *thread_name;
+    struct TraceBuffer *next;
+} TraceBuffer;
+
+int trace_enabled = 0;
+static char trace_file[256];
+static long long trace_epoch_ns;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER; // Guards the list of buffers
+static TraceBuffer *trace_buffers;
+static int trace_threads;
+static __thread TraceBuffer *trace_buffer; // The calling thread's buffer
+
+// Function to read the monotonic clock in nanoseconds
+long long trace_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Function to start recording spans, written to filename when the program exits
+void trace_start(const char *filename) {
+    snprintf(trace_file, sizeof(trace_file), "%s", filename);
+    trace_epoch_ns = trace_now_ns();
+    trace_enabled = 1;
+    atexit(trace_write);
+}
+
+// Function to get the calling thread's buffer, registering it on first use
+TraceBuffer* trace_thread_buffer(void) {
+    if (trace_buffer == NULL) {
+        TraceBuffer *buffer = calloc(1, sizeof(TraceBuffer));
+        if (buffer == NULL) {
+            return NULL;
+        }
+        pthread_mutex_lock(&trace_lock);
+        buffer->tid = ++trace_threads;
+        buffer->next = trace_buffers;
+        trace_buffers = buffer;
+        pthread_mutex_unlock(&trace_lock);
+        trace_buffer = buffer;
+    }
+    return trace_buffer;
+}
+
+// Function to record the start ('B') or end ('E') of a span on the calling thread
+void trace_event(const char *name, char phase) {
+    long long now = trace_now_ns();
+    TraceBuffer *buffer = trace_thread_buffer();
+    if (buffer == NULL) {
+        return;
+    }
+    if (buffer->count == buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : TRACE_INITIAL_EVENTS;
+        TraceEvent *events = realloc(buffer->events, capacity * sizeof(TraceEvent));
+        if (events == NULL) {
+            return; // Drop the event rather than stop the game
+        }
+        buffer->events = events;
+        buffer->capacity = capacity;
+    }
+    buffer->events[buffer->count++] = (TraceEvent){ name, now - trace_epoch_ns, phase };
+}
+
+// Function to label the calling thread in the trace viewer
+void trace_thread_name(const char *name) {
+    if (trace_enabled) {
+        TraceBuffer *buffer = trace_thread_buffer();
+        if (buffer != NULL) {
+            buffer->thread_name = name;
+        }
+    }
+}
+
+// Function to write every thread's spans as Chrome trace-event JSON.
+// Runs at exit, after the game has joined its threads.
+void trace_write(void) {
+    if (!trace_enabled) {
+        return;
+    }
+    trace_enabled = 0; // Nothing more is recorded while writing
+    FILE *file = fopen(trace_file, "w");
+    if (file == NULL) {
+        perror("Error opening trace file");
+        return;
+    }
+
+    int pid = (int)getpid();
+    const char *separator = "";
+    fprintf(file, "{\"traceEvents\":[\n");
+    pthread_mutex_lock(&trace_lock);
+    for (TraceBuffer *buffer = trace_buffers; buffer != NULL; buffer = buffer->next) {
+        if (buffer->thread_name != NULL) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    separator, pid, buffer->tid, buffer->thread_name);
+            separator = ",\n";
+        }
+        for (size_t i = 0; i < buffer->count; i++) {
+            TraceEvent *event = &buffer->events[i];
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%lld.%03lld}", separator,
+                    event->name, event->phase, pid, buffer->tid, event->time_ns / 1000, event->time_ns % 1000); // Microseconds
+            separator = ",\n";
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+}
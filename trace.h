@@ -0,0 +1,26 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Spans recorded for profiling and written as Chrome trace-event JSON on exit, for
+// Perfetto or chrome://tracing. Recording starts when FROG_TRACE names an output file.
+// While it is off each span point costs one predictable branch; build with -DNO_TRACE
+// to compile the span points out completely.
+#ifdef NO_TRACE
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#else
+#define TRACE_BEGIN(name) do { if (__builtin_expect(trace_enabled, 0)) trace_event(name, 'B'); } while (0)
+#define TRACE_END(name) do { if (__builtin_expect(trace_enabled, 0)) trace_event(name, 'E'); } while (0)
+#endif
+
+#define TRACE_INITIAL_EVENTS 4096 // Events per thread before the first buffer growth
+
+extern int trace_enabled; // Set once before any threads start
+
+// Function declarations
+void trace_start(const char *filename);
+void trace_event(const char *name, char phase);
+void trace_thread_name(const char *name);
+void trace_write(void);
+
+#endif
@@ -0,0 +1,489 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "carkernel.h"
+#include "versus.h"
+
+// Handshake sent by both sides once the socket is connected
+typedef struct VersusHello {
+    int32_t screen_width;
+    int32_t screen_height;
+    uint32_t seed;
+} VersusHello;
+
+// Input packet sent by both sides for every simulated tick
+typedef struct VersusPacket {
+    int32_t tick;
+    int32_t input;
+} VersusPacket;
+
+// One slot of the rollback history: the inputs of a tick and the state before it
+typedef struct VersusFrame {
+    int tick;
+    int inputs[VERSUS_PLAYERS];
+    PackedVersusState before;
+} VersusFrame;
+
+// Connection state of a running match
+typedef struct VersusLink {
+    int fd;
+    int local_player;
+    int remote_ticks; // Number of remote inputs received so far
+    int remote_gone;
+    unsigned char pending[sizeof(VersusPacket)];
+    size_t pending_size;
+} VersusLink;
+
+// Function to fill a unix socket address from a filesystem path
+int versus_address(struct sockaddr_un *addr, const char *socket_path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        return -1;
+    }
+    strcpy(addr->sun_path, socket_path);
+    return 0;
+}
+
+// Function to wait for the second player on a unix socket
+int versus_host(const char *socket_path) {
+    struct sockaddr_un addr;
+    if (versus_address(&addr, socket_path) < 0) {
+        return -1;
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("Error creating socket");
+        return -1;
+    }
+    unlink(socket_path); // Remove a socket left over from an earlier match
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listener, 1) < 0) {
+        perror("Error listening on socket");
+        close(listener);
+        return -1;
+    }
+    printf("Waiting for the second player on %s...\n", socket_path);
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+        perror("Error accepting connection");
+    }
+    close(listener);
+    unlink(socket_path);
+    return fd;
+}
+
+// Function to connect to a host waiting on a unix socket
+int versus_join(const char *socket_path) {
+    struct sockaddr_un addr;
+    if (versus_address(&addr, socket_path) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Error creating socket");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("Error connecting to host");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to send a whole buffer, retrying on interrupts and full socket buffers
+int versus_send_all(int fd, const void *data, size_t size) {
+    const char *bytes = data;
+    while (size > 0) {
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EINTR || errno == EAGAIN)) {
+            usleep(1000);
+            continue;
+        }
+        if (sent <= 0) {
+            return -1;
+        }
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return 0;
+}
+
+// Function to receive a whole buffer on a blocking socket
+int versus_recv_all(int fd, void *data, size_t size) {
+    char *bytes = data;
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return -1;
+        }
+        bytes += received;
+        size -= (size_t)received;
+    }
+    return 0;
+}
+
+// Function to agree on board size and random seed with the other process
+int versus_handshake(VersusLink *link, Config *config, unsigned int *seed) {
+    VersusHello local = { config->screen_width, config->screen_height, (uint32_t)time(NULL) };
+    VersusHello remote;
+    if (versus_send_all(link->fd, &local, sizeof(local)) < 0 || versus_recv_all(link->fd, &remote, sizeof(remote)) < 0) {
+        return -1;
+    }
+    // Both boards must be identical, so use the smaller terminal and the host's seed
+    if (remote.screen_width < config->screen_width) config->screen_width = remote.screen_width;
+    if (remote.screen_height < config->screen_height) config->screen_height = remote.screen_height;
+    *seed = link->local_player == 0 ? local.seed : remote.seed;
+    return fcntl(link->fd, F_SETFL, fcntl(link->fd, F_GETFL) | O_NONBLOCK);
+}
+
+// Function to copy a player's frog into the shared board
+void versus_load_player(GameState *board, const VersusPlayer *player) {
+    board->frog_x = player->frog_x;
+    board->frog_y = player->frog_y;
+    board->frog_carried = player->frog_carried;
+    board->carrying_car_index = player->carrying_car_index;
+    board->frog_steps = player->frog_steps;
+    board->score = player->score;
+}
+
+// Function to copy the board's frog back into a player
+void versus_store_player(const GameState *board, VersusPlayer *player) {
+    player->frog_x = board->frog_x;
+    player->frog_y = board->frog_y;
+    player->frog_carried = board->frog_carried;
+    player->carrying_car_index = board->carrying_car_index;
+    player->frog_steps = board->frog_steps;
+    player->score = board->score;
+}
+
+// Function to take a compact snapshot of a match
+void versus_pack(const VersusState *state, PackedVersusState *packed) {
+    memset(packed, 0, sizeof(*packed)); // Zero padding so snapshots can be hashed and compared
+    pack_state(&state->board, &packed->board);
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        const VersusPlayer *player = &state->players[p];
+        packed->players[p].frog_x = (int16_t)player->frog_x;
+        packed->players[p].frog_y = (int16_t)player->frog_y;
+        packed->players[p].carrying_car_index = (int16_t)player->carrying_car_index;
+        packed->players[p].frog_carried = (uint8_t)player->frog_carried;
+        packed->players[p].lives = (uint8_t)player->lives;
+        packed->players[p].frog_steps = (uint16_t)player->frog_steps;
+        packed->players[p].last_jump_tick = player->last_jump_tick;
+        packed->players[p].score = player->score;
+    }
+    packed->winner = (int8_t)state->winner;
+}
+
+// Function to restore a match from a compact snapshot
+void versus_unpack(const PackedVersusState *packed, VersusState *state) {
+    unpack_state(&packed->board, &state->board);
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        VersusPlayer *player = &state->players[p];
+        player->frog_x = packed->players[p].frog_x;
+        player->frog_y = packed->players[p].frog_y;
+        player->carrying_car_index = packed->players[p].carrying_car_index;
+        player->frog_carried = packed->players[p].frog_carried;
+        player->lives = packed->players[p].lives;
+        player->frog_steps = packed->players[p].frog_steps;
+        player->last_jump_tick = packed->players[p].last_jump_tick;
+        player->score = packed->players[p].score;
+    }
+    state->winner = packed->winner;
+}
+
+// Function to put a player's frog back on its starting square
+void versus_reset_frog(VersusPlayer *player, Config *config, int p) {
+    player->frog_x = config->screen_width * (p + 1) / (VERSUS_PLAYERS + 1);
+    player->frog_y = config->screen_height - 2;
+    player->frog_carried = 0;
+    player->carrying_car_index = -1;
+}
+
+// Function to set up a new match from a seed shared by both processes
+void versus_init(VersusState *state, Config *config, unsigned int seed) {
+    memset(state, 0, sizeof(*state));
+    state->board.level = 1;
+    state->board.lives = 3;
+    state->board.rng_state = seed;
+    restart_game(&state->board, config);
+    state->winner = -1;
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        versus_reset_frog(&state->players[p], config, p);
+        state->players[p].lives = state->board.lives;
+        state->players[p].last_jump_tick = -VERSUS_TICKS_PER_SECOND;
+    }
+}
+
+// Function to apply one player's input for the current tick
+void versus_apply_input(VersusState *state, Config *config, int p, int input) {
+    static const int dx[] = { 0, 0, 0, -1, 1 };
+    static const int dy[] = { 0, -1, 1, 0, 0 };
+    VersusPlayer *player = &state->players[p];
+
+    if (input < INPUT_UP || input > INPUT_RIGHT) {
+        return;
+    }
+    if (state->board.tick - player->last_jump_tick < VERSUS_TICKS_PER_SECOND) {
+        return; // One jump per second, as in single player
+    }
+    versus_load_player(&state->board, player);
+    jump_frog(&state->board, config, dx[input], dy[input]);
+    versus_store_player(&state->board, player);
+    player->last_jump_tick = state->board.tick;
+}
+
+// Function to collect coins and resolve collisions for one player
+void versus_check_player(VersusState *state, Config *config, int p) {
+    VersusPlayer *player = &state->players[p];
+
+    versus_load_player(&state->board, player);
+    check_coin_collection(&state->board, config);
+    int collided = check_collision(&state->board);
+    versus_store_player(&state->board, player);
+    if (collided) {
+        player->lives--; // Reduce lives on collision
+        versus_reset_frog(player, config, p);
+    }
+}
+
+// Function to decide the winner once a frog reaches the goal or runs out of lives
+void versus_decide_winner(VersusState *state, const int forfeits[VERSUS_PLAYERS]) {
+    int reached[VERSUS_PLAYERS], lost[VERSUS_PLAYERS];
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        reached[p] = state->players[p].frog_y == 1;
+        lost[p] = forfeits[p] || state->players[p].lives == 0;
+    }
+    if (reached[0] || reached[1]) {
+        state->winner = (reached[0] && reached[1]) ? VERSUS_PLAYERS : (reached[0] ? 0 : 1);
+    } else if (lost[0] || lost[1]) {
+        state->winner = (lost[0] && lost[1]) ? VERSUS_PLAYERS : (lost[0] ? 1 : 0);
+    }
+}
+
+// Function to advance the match by one tick; the result depends only on the state and inputs
+void versus_step(VersusState *state, Config *config, const int inputs[VERSUS_PLAYERS]) {
+    GameState *board = &state->board;
+    int forfeits[VERSUS_PLAYERS];
+
+    if (state->winner >= 0) {
+        return;
+    }
+    board->tick++;
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        forfeits[p] = inputs[p] == INPUT_QUIT;
+        versus_apply_input(state, config, p, inputs[p]);
+    }
+
+    // Cars move once per tick, then each frog checks whether it is being carried
+    update_friendly_car_positions(board, config, 0, board->num_friendly_cars);
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        versus_load_player(board, &state->players[p]);
+        for (int i = 0; i < board->num_friendly_cars; i++) {
+            check_frog_carried(board, i);
+        }
+        update_frog(board);
+        versus_store_player(board, &state->players[p]);
+    }
+
+    // Stopping cars watch each frog on alternate ticks
+    versus_load_player(board, &state->players[board->tick % VERSUS_PLAYERS]);
+    update_enemy_cars(board, config);
+
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        versus_check_player(state, config, p);
+    }
+    versus_decide_winner(state, forfeits);
+}
+
+// Function to get a monotonic timestamp in milliseconds
+long long versus_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Function to map a key press to a versus input
+int versus_key_to_input(int ch) {
+    if (ch == KEY_UP) return INPUT_UP;
+    if (ch == KEY_DOWN) return INPUT_DOWN;
+    if (ch == KEY_LEFT) return INPUT_LEFT;
+    if (ch == KEY_RIGHT) return INPUT_RIGHT;
+    if (ch == 'q') return INPUT_QUIT;
+    return INPUT_NONE;
+}
+
+// Function to get the history slot for a tick, clearing it if it held an older tick
+VersusFrame* versus_frame(VersusFrame *frames, int tick) {
+    VersusFrame *frame = &frames[tick % VERSUS_HISTORY];
+    if (frame->tick != tick) {
+        frame->tick = tick;
+        for (int p = 0; p < VERSUS_PLAYERS; p++) {
+            frame->inputs[p] = INPUT_NONE; // Predict that the remote player presses nothing
+        }
+    }
+    return frame;
+}
+
+// Function to read all pending remote inputs, returning the earliest mispredicted tick
+int versus_receive(VersusLink *link, VersusFrame *frames, int tick) {
+    int remote_player = VERSUS_PLAYERS - 1 - link->local_player;
+    int rollback_from = tick;
+
+    while (!link->remote_gone) {
+        ssize_t received = recv(link->fd, link->pending + link->pending_size, sizeof(link->pending) - link->pending_size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && errno == EAGAIN) {
+            break;
+        }
+        if (received <= 0) {
+            link->remote_gone = 1; // Connection closed or failed
+            break;
+        }
+        link->pending_size += (size_t)received;
+        if (link->pending_size < sizeof(link->pending)) {
+            continue;
+        }
+
+        VersusPacket packet;
+        memcpy(&packet, link->pending, sizeof(packet));
+        link->pending_size = 0;
+        link->remote_ticks = packet.tick + 1;
+
+        VersusFrame *frame = versus_frame(frames, packet.tick);
+        if (packet.tick < tick && frame->inputs[remote_player] != packet.input && packet.tick < rollback_from) {
+            rollback_from = packet.tick;
+        }
+        frame->inputs[remote_player] = packet.input;
+    }
+    return rollback_from;
+}
+
+// Function to restore the snapshot of a mispredicted tick and simulate forward again
+void versus_resimulate(VersusState *state, Config *config, VersusFrame *frames, int from, int tick) {
+    versus_unpack(&frames[from % VERSUS_HISTORY].before, state);
+    for (int t = from; t < tick; t++) {
+        VersusFrame *frame = &frames[t % VERSUS_HISTORY];
+        versus_pack(state, &frame->before);
+        versus_step(state, config, frame->inputs);
+    }
+}
+
+// Function to simulate the next tick with the local input and send that input to the remote side
+void versus_advance(VersusState *state, Config *config, VersusLink *link, VersusFrame *frames, int tick, int input) {
+    VersusFrame *frame = versus_frame(frames, tick);
+    VersusPacket packet = { tick, input };
+
+    frame->inputs[link->local_player] = input;
+    versus_pack(state, &frame->before);
+    if (versus_send_all(link->fd, &packet, sizeof(packet)) < 0) {
+        link->remote_gone = 1;
+    }
+    versus_step(state, config, frame->inputs);
+}
+
+// Function to draw the shared board with both frogs and the match status
+void draw_versus(VersusState *state, Config *config, int local_player) {
+    static GameState view; // Static, since a -DMAX_CARS build can make it too big for the stack
+    view = state->board;
+    int remote_player = VERSUS_PLAYERS - 1 - local_player;
+
+    clear();
+    draw_road(config->screen_height, config->screen_width, config);
+    draw_goal(config->screen_width, config);
+    draw_cars(&view, config);
+    draw_friendly_cars(&view, config);
+    draw_coins(&view, config);
+    draw_obstacles(&view, config);
+    for (int p = 0; p < VERSUS_PLAYERS; p++) {
+        versus_load_player(&view, &state->players[p]);
+        if (p != local_player) attron(A_REVERSE); // Show the rival frog highlighted
+        draw_frog(&view, config);
+        if (p != local_player) attroff(A_REVERSE);
+    }
+    attron(COLOR_PAIR(config->frog_color));
+    mvprintw(0, 0, "You: %d lives, %d points", state->players[local_player].lives, state->players[local_player].score);
+    mvprintw(0, config->screen_width - 26, "Rival: %d lives, %d points", state->players[remote_player].lives, state->players[remote_player].score);
+    attroff(COLOR_PAIR(config->frog_color));
+    refresh();
+}
+
+// Function to show who won the match
+void display_versus_over(VersusState *state, Config *config, int local_player) {
+    char info[100];
+    if (state->winner == local_player) {
+        sprintf(info, "You win! Score: %d", state->players[local_player].score);
+    } else if (state->winner == VERSUS_PLAYERS) {
+        sprintf(info, "Draw! Score: %d", state->players[local_player].score);
+    } else {
+        sprintf(info, "Your rival wins! Score: %d", state->players[local_player].score);
+    }
+    EndGame(info, config);
+}
+
+// Function to run a versus match in lockstep with rollback on mispredicted remote input
+void run_versus(int fd, int local_player, Config *config) {
+    static VersusFrame frames[VERSUS_HISTORY]; // Static, since the history is megabytes on large boards
+    static VersusState state;
+    VersusLink link = { fd, local_player, 0, 0, { 0 }, 0 };
+    unsigned int seed;
+
+    if (versus_handshake(&link, config, &seed) < 0) {
+        endwin();
+        fprintf(stderr, "Error starting versus match.\n");
+        return;
+    }
+    versus_init(&state, config, seed);
+    for (int i = 0; i < VERSUS_HISTORY; i++) {
+        frames[i].tick = -1;
+    }
+
+    int tick = 0; // Next tick to simulate
+    int pending_input = INPUT_NONE;
+    long long next_tick_time = versus_now_ms();
+    timeout(0);
+
+    // Keep going until the result is confirmed by the remote inputs it depends on
+    while (state.winner < 0 || link.remote_ticks < state.board.tick) {
+        if (pending_input == INPUT_NONE) {
+            pending_input = versus_key_to_input(getch());
+        }
+
+        int rollback_from = versus_receive(&link, frames, tick);
+        if (rollback_from < tick) {
+            versus_resimulate(&state, config, frames, rollback_from, tick);
+        }
+        if (link.remote_gone) {
+            state.winner = (state.winner < 0) ? local_player : state.winner;
+            break;
+        }
+
+        // Never run further ahead of the remote player than the rollback history covers
+        if (state.winner < 0 && versus_now_ms() >= next_tick_time && tick - link.remote_ticks < VERSUS_ROLLBACK_WINDOW) {
+            versus_advance(&state, config, &link, frames, tick, pending_input);
+            tick++;
+            next_tick_time += 1000 / VERSUS_TICKS_PER_SECOND;
+            if (pending_input == INPUT_QUIT) {
+                break;
+            }
+            pending_input = INPUT_NONE;
+            draw_versus(&state, config, local_player);
+        }
+        usleep(1000);
+    }
+
+    display_versus_over(&state, config, local_player);
+}
@@ -0,0 +1,69 @@
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include <stdint.h>
+#include "config.h"
+#include "game.h"
+#include "packed_state.h"
+
+#define VERSUS_PLAYERS 2
+#define VERSUS_TICKS_PER_SECOND 20
+#define VERSUS_ROLLBACK_WINDOW 16 // Max ticks the local side may run ahead of the remote input
+#define VERSUS_HISTORY (VERSUS_ROLLBACK_WINDOW * 2)
+
+// Inputs exchanged between the two game processes every tick
+enum VersusInput {
+    INPUT_NONE = 0,
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_LEFT,
+    INPUT_RIGHT,
+    INPUT_QUIT
+};
+
+// VersusPlayer stores the per-player frog state that is swapped into the shared board
+typedef struct VersusPlayer {
+    int frog_x, frog_y;
+    int frog_carried;
+    int carrying_car_index;
+    int frog_steps;
+    int last_jump_tick;
+    int lives;
+    int score;
+} VersusPlayer;
+
+// VersusState is the full deterministic state of a versus match
+typedef struct VersusState {
+    GameState board;
+    VersusPlayer players[VERSUS_PLAYERS];
+    int winner; // -1 while playing, the winning player index, or VERSUS_PLAYERS for a draw
+} VersusState;
+
+// PackedPlayer is the compact form of VersusPlayer kept in rollback snapshots
+typedef struct PackedPlayer {
+    int16_t frog_x, frog_y;
+    int16_t carrying_car_index;
+    uint8_t frog_carried;
+    uint8_t lives;
+    uint16_t frog_steps;
+    int32_t last_jump_tick;
+    int32_t score;
+} PackedPlayer;
+
+// PackedVersusState is a compact snapshot of a whole versus match
+typedef struct PackedVersusState {
+    PackedState board;
+    PackedPlayer players[VERSUS_PLAYERS];
+    int8_t winner;
+} PackedVersusState;
+
+// Function declarations
+int versus_host(const char *socket_path);
+int versus_join(const char *socket_path);
+void versus_init(VersusState *state, Config *config, unsigned int seed);
+void versus_pack(const VersusState *state, PackedVersusState *packed);
+void versus_unpack(const PackedVersusState *packed, VersusState *state);
+void versus_step(VersusState *state, Config *config, const int inputs[VERSUS_PLAYERS]);
+void run_versus(int fd, int local_player, Config *config);
+
+#endif